@@ -0,0 +1,107 @@
+#include <chrono>
+#include <string>
+#include <utility>
+
+#include <boost/filesystem.hpp>
+#include <gflags/gflags.h>
+#include <opencv2/opencv.hpp>
+
+#include <color_calibration/ColorCalibration.hpp>
+#include <common/Logging.hpp>
+#include <common/LoggingInit.hpp>
+#include <common/TaskScheduler.hpp>
+#include <file_io_toolbox/FileSystem.hpp>
+#include <image_toolbox/AsyncImageWriter.hpp>
+#include <image_toolbox/ImageIo.hpp>
+#include <image_toolbox/ImagePrefetcher.hpp>
+
+using namespace komb;
+
+DEFINE_string(input_dir, "", "Directory with camera images (.jpg, .jpeg, .png) to correct.");
+DEFINE_string(output_dir, "color_corrected", "Corrected images are written here, same names.");
+DEFINE_string(ref_image, "resources/ColorChecker_sRGB_from_Lab_D50_AfterNov2014.png",
+    "Path to image with colorchecker reference colors.");
+DEFINE_int32(detection_width, 500, "Images are downscaled to this width before detection.");
+DEFINE_int32(jpeg_quality, 95, "Quality of JPEG output.");
+DEFINE_int32(prefetch_threads, 2, "Threads that read and decode images ahead of time.");
+DEFINE_int32(prefetch_buffer, 4, "Max number of decoded images waiting to be corrected.");
+DEFINE_int32(writer_threads, 2, "Threads that encode and write the corrected images.");
+DEFINE_int32(compute_threads, 0, "Threads for parallel image processing, 0 for one per core.");
+
+using Clock = std::chrono::steady_clock;
+
+/// image is a reduced decode, see readFullAndReducedCvImage.
+cv::Mat3b detectChecker(const cv::Mat3b& image)
+{
+    cv::Mat3b small_image;
+    const double scale = static_cast<double>(FLAGS_detection_width) / image.cols;
+    cv::resize(image, small_image, cv::Size(0, 0), scale, scale, cv::INTER_AREA);
+    cv::blur(small_image, small_image, cv::Size(11, 11));
+    cv::Mat3b no_canvas;
+    return findColorChecker(small_image, no_canvas);
+}
+
+int main(int argc, char* argv[])
+{
+    google::SetUsageMessage(R"(
+Color correct every image in a directory, using a colorchecker visible in each image.
+
+Images are read, decoded, encoded and written on background threads, so the main thread
+only detects colorcheckers and corrects colors.
+Detection runs on a JPEG decode at reduced resolution, which is several times faster.
+Images where no colorchecker is found are skipped.
+)");
+    komb::initLogging(argc, argv);
+    CHECK_F(!FLAGS_input_dir.empty(), "Missing --input_dir");
+    CHECK_GT(FLAGS_detection_width, 0);
+    CHECK_GT(FLAGS_prefetch_threads, 0);
+    CHECK_GT(FLAGS_prefetch_buffer, 0);
+    CHECK_GT(FLAGS_writer_threads, 0);
+    CHECK_GE(FLAGS_compute_threads, 0);
+    setGlobalTaskSchedulerThreads(static_cast<size_t>(FLAGS_compute_threads));
+
+    cv::Mat3b reference_image = readCvImageOrDie(FLAGS_ref_image);
+    cv::Mat3b no_canvas;
+    const cv::Mat3b reference_checker = findColorChecker(reference_image, no_canvas);
+    CHECK_F(!reference_checker.empty(), "findColorChecker failed for reference image.");
+
+    std::vector<fs::path> paths = getFilesInDir(FLAGS_input_dir, ".jpg;.jpeg;.png");
+    sortPaths(paths);
+    const fs::path output_dir = FLAGS_output_dir;
+    fs::create_directories(output_dir);
+
+    // Each file is read once and decoded both in full and at the much cheaper reduced
+    // resolution that detection runs on.
+    const auto start_time = Clock::now();
+    const auto max_buffered = static_cast<size_t>(FLAGS_prefetch_buffer);
+    ImagePrefetcher prefetcher(paths, cv::IMREAD_COLOR, FLAGS_detection_width,
+        static_cast<size_t>(FLAGS_prefetch_threads), max_buffered);
+    AsyncImageWriter writer(static_cast<size_t>(FLAGS_writer_threads), max_buffered);
+    int num_corrected = 0;
+    while (auto prefetched = prefetcher.next())
+    {
+        if (prefetched->image.empty())
+        {
+            continue; // The error has already been logged.
+        }
+
+        cv::Mat3b image = prefetched->image;
+        const cv::Mat3b camera_checker = detectChecker(prefetched->reduced);
+        if (camera_checker.empty())
+        {
+            LOG(WARNING) << "No colorchecker found in " << prefetched->path;
+            continue;
+        }
+
+        applyColorTransformation(image, findColorTransformation(camera_checker, reference_checker));
+        writer.write(output_dir / prefetched->path.filename(), std::move(image),
+            {cv::IMWRITE_JPEG_QUALITY, FLAGS_jpeg_quality});
+        num_corrected += 1;
+    }
+    writer.flush();
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start_time).count();
+    LOG_F(INFO, "Corrected %d of %zu images in %.1f s (%.1f images per second)",
+        num_corrected, paths.size(), seconds, num_corrected / seconds);
+    return 0;
+}
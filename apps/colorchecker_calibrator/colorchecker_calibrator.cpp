@@ -12,6 +12,9 @@ DEFINE_string(cam_image, "resources/ColorChecker_sRGB_from_Lab_D50.png",
     "Path to camera image with a colorchecker that should be calibrated to reference colors.");
 DEFINE_string(ref_image, "resources/ColorChecker_sRGB_from_Lab_D50_AfterNov2014.png",
     "Path to image with colorchecker reference colors.");
+DEFINE_int32(detection_width, 500, "The camera image is downscaled to this width for detection.");
+DEFINE_string(output_image, "",
+    "If set, write the full resolution camera image with corrected colors to this path.");
 
 void imshow(const cv::String& win_name, cv::Mat image, double scale)
 {
@@ -28,8 +31,10 @@ Debugging tool for color correction with colorchecker calibration target.
     komb::initLogging(argc, argv);
 
     cv::Mat3b reference_image = readCvImageOrDie(FLAGS_ref_image);
-    cv::Mat3b camera_image = readCvImageOrDie(FLAGS_cam_image);
-    double scale = 500.0 / camera_image.cols;
+    // Only a reduced resolution decode is needed for detection.
+    cv::Mat3b camera_image = readReducedCvImage(FLAGS_cam_image, FLAGS_detection_width);
+    CHECK_F(!camera_image.empty(), "Failed to load '%s'", FLAGS_cam_image.c_str());
+    double scale = static_cast<double>(FLAGS_detection_width) / camera_image.cols;
     cv::resize(camera_image, camera_image, cv::Size(0, 0), scale, scale, cv::INTER_AREA);
     cv::blur(camera_image, camera_image, cv::Size(11, 11));
 
@@ -80,6 +85,14 @@ Debugging tool for color correction with colorchecker calibration target.
         cv::Mat3b adjusted_image = camera_image.clone();
         applyColorTransformation(adjusted_image, color_transformation);
         cv::imshow("adjusted_colors", adjusted_image);
+
+        if (!FLAGS_output_image.empty())
+        {
+            cv::Mat3b full_image = readCvImageOrDie(FLAGS_cam_image, cv::IMREAD_COLOR);
+            applyColorTransformation(full_image, color_transformation);
+            CHECK_F(writeCvImage(FLAGS_output_image, full_image));
+            LOG(INFO) << "Wrote corrected image to " << FLAGS_output_image;
+        }
     }
 
     while ((cv::waitKey(0) & 255) != 27)
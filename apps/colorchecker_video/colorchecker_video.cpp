@@ -0,0 +1,276 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include <gflags/gflags.h>
+#include <opencv2/opencv.hpp>
+
+#include <color_calibration/ColorCalibration.hpp>
+#include <common/Logging.hpp>
+#include <common/LoggingInit.hpp>
+#include <common/SpscQueue.hpp>
+#include <image_toolbox/ImageIo.hpp>
+
+using namespace komb;
+
+DEFINE_string(input, "", "Path to input video with a colorchecker somewhere in view.");
+DEFINE_string(output, "color_corrected.avi", "Path to color corrected output video.");
+DEFINE_string(ref_image, "resources/ColorChecker_sRGB_from_Lab_D50_AfterNov2014.png",
+    "Path to image with colorchecker reference colors.");
+DEFINE_string(fourcc, "MJPG", "Four character code of the output video codec.");
+DEFINE_int32(detect_every, 5, "Run colorchecker detection on every n:th frame.");
+DEFINE_int32(detection_width, 500, "Frames are downscaled to this width before detection.");
+DEFINE_double(transform_smoothing, 0.8,
+    "How much of the previous color transformation to keep when a new one is found [0, 1).");
+DEFINE_int32(queue_capacity, 8, "Number of frames that may be in flight between two stages.");
+
+using Clock = std::chrono::steady_clock;
+
+struct Frame
+{
+    int         index = 0;
+    cv::Mat3b   image;
+    cv::Matx34f color_transformation;
+    bool        has_transformation = false;
+    bool        end_of_stream = false;
+    Clock::time_point decoded_time;
+};
+
+using FrameQueue = SpscQueue<Frame>;
+
+/// Lock-free latency counter, updated by one stage and read at the end.
+class StageCounter
+{
+public:
+    explicit StageCounter(const char* name) : name_(name) {}
+
+    void add(Clock::duration duration)
+    {
+        const auto ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+        count_.fetch_add(1, std::memory_order_relaxed);
+        total_ns_.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t max_ns = max_ns_.load(std::memory_order_relaxed);
+        while (ns > max_ns && !max_ns_.compare_exchange_weak(max_ns, ns))
+        {
+        }
+    }
+
+    void log() const
+    {
+        const uint64_t count = count_.load();
+        const double mean_ms = count == 0 ? 0.0 : 1e-6 * static_cast<double>(total_ns_.load()) /
+            static_cast<double>(count);
+        LOG_F(INFO, "%-12s %6llu calls, mean %7.2f ms, max %7.2f ms", name_,
+            static_cast<unsigned long long>(count), mean_ms,
+            1e-6 * static_cast<double>(max_ns_.load()));
+    }
+
+private:
+    const char*           name_;
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> total_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+void pushFrame(FrameQueue& queue, Frame&& frame)
+{
+    while (!queue.tryPush(std::move(frame)))
+    {
+        std::this_thread::yield();
+    }
+}
+
+Frame popFrame(FrameQueue& queue)
+{
+    Frame frame;
+    while (!queue.tryPop(frame))
+    {
+        std::this_thread::yield();
+    }
+    return frame;
+}
+
+cv::Mat3b detectChecker(const cv::Mat3b& frame)
+{
+    cv::Mat3b small_frame;
+    const double scale = static_cast<double>(FLAGS_detection_width) / frame.cols;
+    cv::resize(frame, small_frame, cv::Size(0, 0), scale, scale, cv::INTER_AREA);
+    cv::blur(small_frame, small_frame, cv::Size(11, 11));
+    cv::Mat3b no_canvas;
+    return findColorChecker(small_frame, no_canvas);
+}
+
+void decodeStage(cv::VideoCapture& capture, FrameQueue& out, StageCounter& counter)
+{
+    setThreadName("decode");
+    for (int index = 0;; ++index)
+    {
+        const auto start_time = Clock::now();
+        Frame frame;
+        if (!capture.read(frame.image) || frame.image.empty())
+        {
+            frame.end_of_stream = true;
+            pushFrame(out, std::move(frame));
+            return;
+        }
+        frame.index = index;
+        frame.decoded_time = Clock::now();
+        counter.add(frame.decoded_time - start_time);
+        pushFrame(out, std::move(frame));
+    }
+}
+
+/// Tracks the colorchecker over time and tags every frame with the latest color transformation.
+void detectStage(
+    const cv::Mat3b& reference_checker, FrameQueue& in, FrameQueue& out, StageCounter& counter)
+{
+    setThreadName("detect");
+    cv::Matx34f color_transformation;
+    bool has_transformation = false;
+    for (;;)
+    {
+        Frame frame = popFrame(in);
+        if (frame.end_of_stream)
+        {
+            pushFrame(out, std::move(frame));
+            return;
+        }
+
+        if (frame.index % FLAGS_detect_every == 0)
+        {
+            const auto start_time = Clock::now();
+            const cv::Mat3b camera_checker = detectChecker(frame.image);
+            if (camera_checker.empty())
+            {
+                VLOG(1) << "No colorchecker in frame " << frame.index << ", keeping last transform.";
+            }
+            else
+            {
+                const cv::Matx34f new_transformation =
+                    findColorTransformation(camera_checker, reference_checker);
+                const auto keep = static_cast<float>(FLAGS_transform_smoothing);
+                color_transformation = has_transformation
+                    ? keep * color_transformation + (1.0f - keep) * new_transformation
+                    : new_transformation;
+                has_transformation = true;
+            }
+            counter.add(Clock::now() - start_time);
+        }
+
+        frame.color_transformation = color_transformation;
+        frame.has_transformation = has_transformation;
+        pushFrame(out, std::move(frame));
+    }
+}
+
+void correctStage(FrameQueue& in, FrameQueue& out, StageCounter& counter)
+{
+    setThreadName("correct");
+    for (;;)
+    {
+        Frame frame = popFrame(in);
+        if (frame.has_transformation && !frame.end_of_stream)
+        {
+            const auto start_time = Clock::now();
+            applyColorTransformation(frame.image, frame.color_transformation);
+            counter.add(Clock::now() - start_time);
+        }
+        const bool end_of_stream = frame.end_of_stream;
+        pushFrame(out, std::move(frame));
+        if (end_of_stream)
+        {
+            return;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    google::SetUsageMessage(R"(
+Color correct a video using a colorchecker calibration target visible in the frames.
+
+Decoding, detection, correction and encoding run as separate pipeline stages.
+Frames before the first detection are written uncorrected.
+)");
+    komb::initLogging(argc, argv);
+    CHECK_F(!FLAGS_input.empty(), "Missing --input");
+    CHECK_GT(FLAGS_detect_every, 0);
+    CHECK_GT(FLAGS_queue_capacity, 0);
+    CHECK_F(0.0 <= FLAGS_transform_smoothing && FLAGS_transform_smoothing < 1.0,
+        "--transform_smoothing must be in [0, 1)");
+    CHECK_EQ(FLAGS_fourcc.size(), 4u);
+
+    cv::Mat3b reference_image = readCvImageOrDie(FLAGS_ref_image);
+    cv::Mat3b no_canvas;
+    const cv::Mat3b reference_checker = findColorChecker(reference_image, no_canvas);
+    CHECK_F(!reference_checker.empty(), "findColorChecker failed for reference image.");
+
+    cv::VideoCapture capture(FLAGS_input);
+    CHECK_F(capture.isOpened(), "Failed to open '%s'", FLAGS_input.c_str());
+    const cv::Size frame_size(
+        static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH)),
+        static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT)));
+    double fps = capture.get(cv::CAP_PROP_FPS);
+    if (fps <= 0.0)
+    {
+        fps = 30.0;
+    }
+
+    const int fourcc = cv::VideoWriter::fourcc(
+        FLAGS_fourcc[0], FLAGS_fourcc[1], FLAGS_fourcc[2], FLAGS_fourcc[3]);
+    cv::VideoWriter writer(FLAGS_output, fourcc, fps, frame_size);
+    CHECK_F(writer.isOpened(), "Failed to open '%s' for writing", FLAGS_output.c_str());
+
+    const auto queue_capacity = static_cast<size_t>(FLAGS_queue_capacity);
+    FrameQueue decoded_frames(queue_capacity);
+    FrameQueue tagged_frames(queue_capacity);
+    FrameQueue corrected_frames(queue_capacity);
+
+    StageCounter decode_counter("decode");
+    StageCounter detect_counter("detect");
+    StageCounter correct_counter("correct");
+    StageCounter encode_counter("encode");
+    StageCounter end_to_end_counter("end to end");
+
+    const auto start_time = Clock::now();
+    std::thread decode_thread(decodeStage,
+        std::ref(capture), std::ref(decoded_frames), std::ref(decode_counter));
+    std::thread detect_thread(detectStage, std::cref(reference_checker),
+        std::ref(decoded_frames), std::ref(tagged_frames), std::ref(detect_counter));
+    std::thread correct_thread(correctStage,
+        std::ref(tagged_frames), std::ref(corrected_frames), std::ref(correct_counter));
+
+    int num_frames = 0;
+    for (;;)
+    {
+        Frame frame = popFrame(corrected_frames);
+        if (frame.end_of_stream)
+        {
+            break;
+        }
+        const auto encode_start_time = Clock::now();
+        writer.write(frame.image);
+        const auto encode_end_time = Clock::now();
+        encode_counter.add(encode_end_time - encode_start_time);
+        end_to_end_counter.add(encode_end_time - frame.decoded_time);
+        num_frames += 1;
+    }
+
+    decode_thread.join();
+    detect_thread.join();
+    correct_thread.join();
+
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - start_time).count();
+    LOG_F(INFO, "Wrote %d frames to '%s' in %.1f s (%.1f fps)", num_frames,
+        FLAGS_output.c_str(), seconds, num_frames / seconds);
+    decode_counter.log();
+    detect_counter.log();
+    correct_counter.log();
+    encode_counter.log();
+    end_to_end_counter.log();
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <gflags/gflags.h>
+
+#include <checker_generator/CheckerScene.hpp>
+#include <common/Logging.hpp>
+#include <common/LoggingInit.hpp>
+#include <common/String.hpp>
+#include <common/TaskScheduler.hpp>
+#include <file_io_toolbox/FileIo.hpp>
+#include <image_toolbox/ImageIo.hpp>
+
+using namespace komb;
+
+DEFINE_string(output_dir, "checker_scenes", "Directory to write images and ground truth to.");
+DEFINE_int32(num_images, 1000, "Number of scenes to render.");
+DEFINE_uint64(seed, 0, "Scene i is rendered with seed + i.");
+DEFINE_int32(width, 1920, "Image width in pixels.");
+DEFINE_int32(height, 1080, "Image height in pixels.");
+DEFINE_int32(jpeg_quality, 95, "Write JPEG with this quality, or PNG if 0.");
+DEFINE_double(min_checker_fraction, 0.2, "Min checker width as a fraction of image width.");
+DEFINE_double(max_checker_fraction, 0.6, "Max checker width as a fraction of image width.");
+DEFINE_double(max_rotation_deg, 30, "Max in-plane rotation of the checker.");
+DEFINE_double(max_perspective, 0.1, "Max corner displacement as a fraction of checker width.");
+DEFINE_double(max_blur_sigma, 1.5, "Max Gaussian blur in pixels.");
+DEFINE_double(noise_sigma, 2, "Gaussian noise in [0, 255] units.");
+DEFINE_double(max_color_cast, 0.2, "Max relative gain change of each color channel.");
+DEFINE_int32(num_clutter_shapes, 30, "Number of random shapes in the background.");
+DEFINE_int32(compute_threads, 0, "Threads rendering scenes in parallel, 0 for one per core.");
+
+int main(int argc, char* argv[])
+{
+    google::SetUsageMessage(R"(
+Render synthetic colorchecker scenes with ground truth patch colors and positions.
+
+For each scene i, writes scene_<i>.jpg (or .png) and scene_<i>.json to --output_dir.
+Scenes are rendered in parallel, on all cores unless --compute_threads says otherwise.
+)");
+    komb::initLogging(argc, argv);
+    CHECK_GE(FLAGS_num_images, 0);
+    CHECK_GE(FLAGS_compute_threads, 0);
+    setGlobalTaskSchedulerThreads(static_cast<size_t>(FLAGS_compute_threads));
+
+    CheckerSceneParams params;
+    params.image_size = cv::Size(FLAGS_width, FLAGS_height);
+    params.min_checker_fraction = static_cast<float>(FLAGS_min_checker_fraction);
+    params.max_checker_fraction = static_cast<float>(FLAGS_max_checker_fraction);
+    params.max_rotation_deg = static_cast<float>(FLAGS_max_rotation_deg);
+    params.max_perspective = static_cast<float>(FLAGS_max_perspective);
+    params.max_blur_sigma = static_cast<float>(FLAGS_max_blur_sigma);
+    params.noise_sigma = static_cast<float>(FLAGS_noise_sigma);
+    params.max_color_cast = static_cast<float>(FLAGS_max_color_cast);
+    params.num_clutter_shapes = FLAGS_num_clutter_shapes;
+
+    const fs::path output_dir = FLAGS_output_dir;
+    fs::create_directories(output_dir);
+
+    const auto start_time = std::chrono::steady_clock::now();
+    std::atomic<int> num_done{0};
+
+    const auto num_images = static_cast<size_t>(FLAGS_num_images);
+    globalTaskScheduler().parallelFor(num_images, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const CheckerScene scene = renderCheckerScene(params, FLAGS_seed + i);
+            const std::string stem = strprintf("scene_%06zu", i);
+            if (FLAGS_jpeg_quality > 0)
+            {
+                writeJpegWithQuality(output_dir / (stem + ".jpg"), scene.image, FLAGS_jpeg_quality);
+            }
+            else
+            {
+                writeCvImage(output_dir / (stem + ".png"), scene.image);
+            }
+            writeTextFile(output_dir / (stem + ".json"),
+                configuru::dump_string(checkerSceneToJson(scene), configuru::JSON));
+
+            const int done = ++num_done;
+            LOG_IF_F(INFO, done % 100 == 0, "Rendered %d/%d scenes", done, FLAGS_num_images);
+        }
+    });
+
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    LOG_F(INFO, "Rendered %d scenes to '%s' in %.1f s (%.0f scenes per minute)",
+        FLAGS_num_images, output_dir.c_str(), seconds, 60 * FLAGS_num_images / seconds);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <utility>
+
+#include <common/Logging.hpp>
+#include <common/LoggingInit.hpp>
+
+namespace komb {
+
+BenchmarkRunner::BenchmarkRunner(double min_seconds, int min_iterations, std::string filter)
+    : min_seconds_(min_seconds)
+    , min_iterations_(min_iterations)
+    , filter_(std::move(filter))
+{
+    CHECK_GT(min_iterations_, 0);
+}
+
+bool BenchmarkRunner::run(const std::string& name, double megapixels, int num_threads,
+    const std::function<void()>& function)
+{
+    if (name.find(filter_) == std::string::npos)
+    {
+        return false;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    function(); // Warm up caches and lazily allocated buffers.
+
+    std::vector<double> times_ms;
+    const auto start_time = Clock::now();
+    while (static_cast<int>(times_ms.size()) < min_iterations_ ||
+           std::chrono::duration<double>(Clock::now() - start_time).count() < min_seconds_)
+    {
+        const auto iteration_start_time = Clock::now();
+        function();
+        times_ms.push_back(std::chrono::duration<double, std::milli>(
+            Clock::now() - iteration_start_time).count());
+    }
+
+    std::sort(times_ms.begin(), times_ms.end());
+    BenchmarkResult result;
+    result.name = name;
+    result.megapixels = megapixels;
+    result.num_threads = num_threads;
+    result.iterations = static_cast<int>(times_ms.size());
+    result.median_ms = times_ms[times_ms.size() / 2];
+    result.min_ms = times_ms.front();
+    result.max_ms = times_ms.back();
+    for (double time_ms : times_ms)
+    {
+        result.mean_ms += time_ms / static_cast<double>(times_ms.size());
+    }
+
+    LOG_F(INFO, "%-28s %5.1f MP %3d threads: median %9.3f ms, min %9.3f ms (%d iterations)",
+        name.c_str(), megapixels, num_threads, result.median_ms, result.min_ms,
+        result.iterations);
+    results_.push_back(result);
+    return true;
+}
+
+Json BenchmarkRunner::toJson() const
+{
+    Json json_results = Json::array();
+    for (const auto& result : results_)
+    {
+        Json json_result = Json::object();
+        json_result["name"] = result.name;
+        json_result["megapixels"] = result.megapixels;
+        json_result["num_threads"] = result.num_threads;
+        json_result["iterations"] = result.iterations;
+        json_result["mean_ms"] = result.mean_ms;
+        json_result["median_ms"] = result.median_ms;
+        json_result["min_ms"] = result.min_ms;
+        json_result["max_ms"] = result.max_ms;
+        json_results.push_back(json_result);
+    }
+
+    Json json = Json::object();
+    json["date"] = getDateTimeMillisecons();
+    json["hardware_concurrency"] = static_cast<int>(std::thread::hardware_concurrency());
+    json["results"] = json_results;
+    return json;
+}
+
+} // namespace komb
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <common/Json.hpp>
+
+namespace komb {
+
+struct BenchmarkResult
+{
+    std::string name;
+    double      megapixels = 0; ///< Image size the benchmark ran on, or 0 if not image based.
+    int         num_threads = 0;
+    int         iterations = 0;
+    double      mean_ms = 0;
+    double      median_ms = 0;
+    double      min_ms = 0;
+    double      max_ms = 0;
+};
+
+/**
+ * @brief Minimal benchmark harness.
+ *
+ * Each benchmark is run once to warm up and then repeatedly until both min_iterations
+ * and min_seconds are reached. Results are collected so that they can be dumped as JSON
+ * and compared between commits with scripts/compare_benchmarks.py.
+ */
+class BenchmarkRunner
+{
+public:
+    /// Only benchmarks whose name contains filter are run.
+    BenchmarkRunner(double min_seconds, int min_iterations, std::string filter);
+
+    /// Returns false if the benchmark was filtered out.
+    bool run(const std::string& name, double megapixels, int num_threads,
+        const std::function<void()>& function);
+
+    const std::vector<BenchmarkResult>& results() const { return results_; }
+
+    Json toJson() const;
+
+private:
+    double                       min_seconds_;
+    int                          min_iterations_;
+    std::string                  filter_;
+    std::vector<BenchmarkResult> results_;
+};
+
+} // namespace komb
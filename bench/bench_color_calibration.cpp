@@ -0,0 +1,161 @@
+#include <cmath>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <gflags/gflags.h>
+#include <opencv2/opencv.hpp>
+
+#include <checker_generator/CheckerScene.hpp>
+#include <color_calibration/ColorCalibration.hpp>
+#include <common/Logging.hpp>
+#include <common/LoggingInit.hpp>
+#include <common/Path.hpp>
+#include <common/ScopeExit.hpp>
+#include <common/String.hpp>
+#include <file_io_toolbox/FileIo.hpp>
+#include <image_toolbox/Gamma.hpp>
+#include <image_toolbox/ImageIo.hpp>
+#include <image_toolbox/Magnitude.hpp>
+
+#include "Benchmark.hpp"
+
+using namespace komb;
+
+DEFINE_string(json_out, "", "Write benchmark results as JSON to this file.");
+DEFINE_string(filter, "", "Only run benchmarks whose name contains this string.");
+DEFINE_double(min_seconds, 0.5, "Run each benchmark for at least this long.");
+DEFINE_int32(min_iterations, 3, "Run each benchmark at least this many times.");
+DEFINE_double(max_megapixels, 24, "Skip image sizes larger than this.");
+DEFINE_int32(num_threads, 0, "Threads for the multi-threaded runs. 0 means all cores.");
+
+struct ImageSize
+{
+    double megapixels;
+    cv::Size size;
+};
+
+const std::vector<ImageSize> kImageSizes{
+    {0.3, cv::Size(640, 480)},
+    {2.0, cv::Size(1920, 1080)},
+    {12.0, cv::Size(4000, 3000)},
+    {24.0, cv::Size(6000, 4000)},
+};
+
+/// A checker covering half the image width on a noisy background, without distortions.
+cv::Mat3b renderSyntheticChecker(cv::Size size)
+{
+    CheckerSceneParams params;
+    params.image_size = size;
+    params.min_checker_fraction = 0.5f;
+    params.max_checker_fraction = 0.5f;
+    params.max_rotation_deg = 0;
+    params.max_perspective = 0;
+    params.max_blur_sigma = 0;
+    params.max_color_cast = 0;
+    return renderCheckerScene(params, 0).image;
+}
+
+void runBenchmarks(BenchmarkRunner& runner, int num_threads, const fs::path& temp_dir)
+{
+    cv::setNumThreads(num_threads);
+
+    const cv::Mat3b reference_checker = standardCheckerColors();
+    const cv::Matx34f color_transformation(
+        0.9f, 0.05f, 0.02f, 3.0f,
+        0.03f, 1.1f, 0.01f, -2.0f,
+        0.01f, 0.04f, 0.95f, 1.0f);
+
+    cv::Mat3b camera_checker = reference_checker.clone();
+    applyColorTransformation(camera_checker, color_transformation);
+    runner.run("findColorTransformation", 0, num_threads, [&]()
+    {
+        findColorTransformation(camera_checker, reference_checker);
+    });
+
+    for (const auto& image_size : kImageSizes)
+    {
+        if (image_size.megapixels > FLAGS_max_megapixels)
+        {
+            continue;
+        }
+        const double mp = image_size.megapixels;
+        const cv::Mat3b image = renderSyntheticChecker(image_size.size);
+        cv::Mat3b no_canvas;
+
+        runner.run("edgeMagnitude", mp, num_threads, [&]()
+        {
+            edgeMagnitude(image);
+        });
+        runner.run("findSquares", mp, num_threads, [&]()
+        {
+            findSquares(image, no_canvas);
+        });
+        runner.run("findColorChecker", mp, num_threads, [&]()
+        {
+            findColorChecker(image, no_canvas);
+        });
+
+        cv::Mat3b work_image = image.clone();
+        runner.run("applyColorTransformation", mp, num_threads, [&]()
+        {
+            applyColorTransformation(work_image, color_transformation);
+        });
+
+        const cv::Mat3f linear_image = linearFromByte3(image);
+        runner.run("linearFromByte3", mp, num_threads, [&]()
+        {
+            linearFromByte3(image);
+        });
+        runner.run("byteFromLinear3", mp, num_threads, [&]()
+        {
+            byteFromLinear3(linear_image);
+        });
+
+        for (const std::string extension : {"png", "jpg"})
+        {
+            const fs::path path = temp_dir / strprintf("checker_%.1f.%s", mp, extension.c_str());
+            if (!fs::exists(path))
+            {
+                CHECK_F(writeCvImage(path, image), "Failed to write '%s'", path.c_str());
+            }
+            runner.run("readCvImage_" + extension, mp, num_threads, [&]()
+            {
+                readCvImage(path, cv::IMREAD_COLOR);
+            });
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    google::SetUsageMessage(R"(
+Benchmarks for the color calibration pipeline on synthetic colorcheckers.
+
+Every benchmark is run single-threaded and with --num_threads threads.
+Compare two --json_out files with scripts/compare_benchmarks.py.
+)");
+    komb::initLogging(argc, argv);
+
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("bench_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    const int max_threads = FLAGS_num_threads > 0
+        ? FLAGS_num_threads : static_cast<int>(std::thread::hardware_concurrency());
+
+    BenchmarkRunner runner(FLAGS_min_seconds, FLAGS_min_iterations, FLAGS_filter);
+    runBenchmarks(runner, 1, temp_dir);
+    if (max_threads > 1)
+    {
+        runBenchmarks(runner, max_threads, temp_dir);
+    }
+
+    if (!FLAGS_json_out.empty())
+    {
+        writeTextFile(FLAGS_json_out, configuru::dump_string(runner.toJson(), configuru::JSON));
+        LOG(INFO) << "Wrote results to " << FLAGS_json_out;
+    }
+    return 0;
+}
@@ -0,0 +1,248 @@
+#include "CheckerScene.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include <common/algorithm/Range.hpp>
+#include <common/Logging.hpp>
+#include <common/Random.hpp>
+#include <geometry_toolbox/Angle.hpp>
+
+namespace komb {
+
+namespace {
+
+const int kNumRows = 4;
+const int kNumCols = 6;
+
+// Sizes in units of the patch side length.
+const float kGap = 0.2f;
+const float kBoardWidth = kNumCols + (kNumCols + 1) * kGap;
+const float kBoardHeight = kNumRows + (kNumRows + 1) * kGap;
+
+cv::Point2f patchCenter(int row, int col, float patch_size)
+{
+    return cv::Point2f(
+        patch_size * (kGap + col * (1 + kGap) + 0.5f),
+        patch_size * (kGap + row * (1 + kGap) + 0.5f));
+}
+
+cv::Mat3b renderBoard(float patch_size)
+{
+    const cv::Mat3b colors = standardCheckerColors();
+    cv::Mat3b board(
+        static_cast<int>(std::ceil(kBoardHeight * patch_size)),
+        static_cast<int>(std::ceil(kBoardWidth * patch_size)),
+        cv::Vec3b(20, 20, 20));
+    for (int row : irange(kNumRows))
+    {
+        for (int col : irange(kNumCols))
+        {
+            const cv::Point2f center = patchCenter(row, col, patch_size);
+            const cv::Point2f half_size(patch_size / 2, patch_size / 2);
+            cv::rectangle(board, cv::Rect(center - half_size, center + half_size),
+                cv::Scalar(colors(row, col)), -1);
+        }
+    }
+    return board;
+}
+
+void drawClutter(cv::Mat3b& image, int num_shapes, RandomEngine& rng)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_int_distribution<int> channel(0, 255);
+    const float image_width = static_cast<float>(image.cols);
+
+    for (int i = 0; i < num_shapes; ++i)
+    {
+        const cv::Scalar color(channel(rng), channel(rng), channel(rng));
+        const cv::Point2f center(unit(rng) * image.cols, unit(rng) * image.rows);
+        const float size = image_width * (0.02f + 0.13f * unit(rng));
+        switch (i % 3)
+        {
+        case 0:
+        {
+            cv::Point2f corners[4];
+            cv::RotatedRect(center, cv::Size2f(size, size * (0.3f + unit(rng))),
+                360.0f * unit(rng)).points(corners);
+            std::vector<cv::Point> polygon(corners, corners + 4);
+            cv::fillConvexPoly(image, polygon, color, cv::LINE_AA);
+            break;
+        }
+        case 1:
+            cv::circle(image, center, static_cast<int>(size / 2), color, -1, cv::LINE_AA);
+            break;
+        default:
+        {
+            const float angle = kTau_f * unit(rng);
+            const cv::Point2f offset(size * std::cos(angle), size * std::sin(angle));
+            cv::line(image, center - offset, center + offset, color,
+                std::max(1, static_cast<int>(size / 20)), cv::LINE_AA);
+            break;
+        }
+        }
+    }
+}
+
+} // namespace
+
+cv::Mat3b standardCheckerColors()
+{
+    const uint8_t rgb[kNumRows][kNumCols][3] = {
+        {{115, 82, 68}, {194, 150, 130}, {98, 122, 157},
+         {87, 108, 67}, {133, 128, 177}, {103, 189, 170}},
+        {{214, 126, 44}, {80, 91, 166}, {193, 90, 99},
+         {94, 60, 108}, {157, 188, 64}, {224, 163, 46}},
+        {{56, 61, 150}, {70, 148, 73}, {175, 54, 60},
+         {231, 199, 31}, {187, 86, 149}, {8, 133, 161}},
+        {{243, 243, 242}, {200, 200, 200}, {160, 160, 160},
+         {122, 122, 121}, {85, 85, 85}, {52, 52, 52}},
+    };
+
+    cv::Mat3b colors(kNumRows, kNumCols);
+    for (int row : irange(kNumRows))
+    {
+        for (int col : irange(kNumCols))
+        {
+            colors(row, col) = cv::Vec3b(rgb[row][col][2], rgb[row][col][1], rgb[row][col][0]);
+        }
+    }
+    return colors;
+}
+
+CheckerScene renderCheckerScene(const CheckerSceneParams& params, uint64_t seed)
+{
+    CHECK_GT(params.image_size.area(), 0);
+    CHECK_LE(params.min_checker_fraction, params.max_checker_fraction);
+
+    RandomEngine rng = getRandomEngine(seed);
+    auto uniform = [&rng](float min, float max)
+    {
+        return min < max ? std::uniform_real_distribution<float>(min, max)(rng) : min;
+    };
+
+    CheckerScene scene;
+    std::uniform_int_distribution<int> background_level(60, 180);
+    const int gray = background_level(rng);
+    scene.image.create(params.image_size);
+    scene.image = cv::Vec3b(cv::saturate_cast<uint8_t>(gray + uniform(-20, 20)),
+        cv::saturate_cast<uint8_t>(gray + uniform(-20, 20)),
+        cv::saturate_cast<uint8_t>(gray + uniform(-20, 20)));
+    drawClutter(scene.image, params.num_clutter_shapes, rng);
+
+    // Place the checker so that it stays inside the image.
+    const float image_width = static_cast<float>(params.image_size.width);
+    const float image_height = static_cast<float>(params.image_size.height);
+    const float checker_width =
+        image_width * uniform(params.min_checker_fraction, params.max_checker_fraction);
+    const float patch_size = checker_width / kBoardWidth;
+    const float checker_height = patch_size * kBoardHeight;
+    const float max_jitter = params.max_perspective * checker_width;
+    const float radius = 0.5f * std::hypot(checker_width, checker_height) + max_jitter;
+    const cv::Point2f center(
+        radius < image_width / 2 ? uniform(radius, image_width - radius) : image_width / 2,
+        radius < image_height / 2 ? uniform(radius, image_height - radius) : image_height / 2);
+    const float angle =
+        radiansFromDegrees(uniform(-params.max_rotation_deg, params.max_rotation_deg));
+    const float cos_angle = std::cos(angle);
+    const float sin_angle = std::sin(angle);
+
+    const cv::Point2f board_corners[4] = {
+        {0, 0}, {checker_width, 0}, {checker_width, checker_height}, {0, checker_height}};
+    cv::Point2f image_corners[4];
+    for (int i : irange(4))
+    {
+        const cv::Point2f centered =
+            board_corners[i] - cv::Point2f(checker_width, checker_height) / 2;
+        image_corners[i] = center + cv::Point2f(
+            cos_angle * centered.x - sin_angle * centered.y + uniform(-max_jitter, max_jitter),
+            sin_angle * centered.x + cos_angle * centered.y + uniform(-max_jitter, max_jitter));
+    }
+    scene.homography = cv::getPerspectiveTransform(board_corners, image_corners);
+
+    // Only warp the part of the image that the checker covers.
+    const std::vector<cv::Point2f> corner_vector(image_corners, image_corners + 4);
+    const cv::Rect roi =
+        cv::boundingRect(corner_vector) & cv::Rect(cv::Point(0, 0), params.image_size);
+    const cv::Matx33d roi_from_image(1, 0, -roi.x, 0, 1, -roi.y, 0, 0, 1);
+    cv::Mat3b image_roi = scene.image(roi);
+    cv::warpPerspective(renderBoard(patch_size), image_roi, roi_from_image * scene.homography,
+        roi.size(), cv::INTER_LINEAR, cv::BORDER_TRANSPARENT);
+
+    std::vector<cv::Point2f> board_centers;
+    for (int row : irange(kNumRows))
+    {
+        for (int col : irange(kNumCols))
+        {
+            board_centers.push_back(patchCenter(row, col, patch_size));
+        }
+    }
+    cv::perspectiveTransform(board_centers, scene.patch_centers, scene.homography);
+
+    // The illumination color cast affects the whole scene, including the checker.
+    for (int channel : irange(3))
+    {
+        scene.color_gains[channel] = 1 + uniform(-params.max_color_cast, params.max_color_cast);
+    }
+    const cv::Scalar gains(scene.color_gains[0], scene.color_gains[1], scene.color_gains[2]);
+    cv::multiply(scene.image, gains, scene.image);
+    cv::multiply(standardCheckerColors(), gains, scene.patch_colors);
+
+    scene.blur_sigma = uniform(0, params.max_blur_sigma);
+    if (scene.blur_sigma > 0.1f)
+    {
+        cv::GaussianBlur(scene.image, scene.image, cv::Size(0, 0), scene.blur_sigma);
+    }
+
+    if (params.noise_sigma > 0)
+    {
+        cv::RNG cv_rng(rng());
+        cv::Mat3s noise(params.image_size);
+        cv_rng.fill(noise, cv::RNG::NORMAL,
+            cv::Scalar::all(0), cv::Scalar::all(params.noise_sigma));
+        cv::add(scene.image, noise, scene.image, cv::noArray(), CV_8UC3);
+    }
+
+    return scene;
+}
+
+Json checkerSceneToJson(const CheckerScene& scene)
+{
+    Json patches = Json::array();
+    for (int row : irange(scene.patch_colors.rows))
+    {
+        for (int col : irange(scene.patch_colors.cols))
+        {
+            const cv::Vec3b& bgr = scene.patch_colors(row, col);
+            const cv::Point2f& center = scene.patch_centers[row * scene.patch_colors.cols + col];
+            patches.push_back(Json{
+                {"row", row},
+                {"col", col},
+                {"bgr", Json::array({int(bgr[0]), int(bgr[1]), int(bgr[2])})},
+                {"center", Json::array({center.x, center.y})},
+            });
+        }
+    }
+
+    Json homography = Json::array();
+    for (int i : irange(9))
+    {
+        homography.push_back(scene.homography.val[i]);
+    }
+
+    return Json{
+        {"width", scene.image.cols},
+        {"height", scene.image.rows},
+        {"patches", patches},
+        {"homography", homography},
+        {"color_gains",
+            Json::array({scene.color_gains[0], scene.color_gains[1], scene.color_gains[2]})},
+        {"blur_sigma", scene.blur_sigma},
+    };
+}
+
+} // namespace komb
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include <common/Json.hpp>
+
+namespace komb {
+
+/// Colors of the X-Rite ColorChecker Classic in sRGB (after November 2014), as 4x6 BGR.
+cv::Mat3b standardCheckerColors();
+
+/// Ranges that the scene parameters are drawn uniformly from.
+struct CheckerSceneParams
+{
+    cv::Size image_size{1920, 1080};
+    float    min_checker_fraction = 0.2f; ///< Checker width as a fraction of the image width.
+    float    max_checker_fraction = 0.6f;
+    float    max_rotation_deg = 30.0f;
+    float    max_perspective = 0.1f;      ///< Corner displacement as a fraction of checker width.
+    float    max_blur_sigma = 1.5f;       ///< In pixels.
+    float    noise_sigma = 2.0f;          ///< Gaussian noise in [0, 255] units.
+    float    max_color_cast = 0.2f;       ///< Relative gain change of each color channel.
+    int      num_clutter_shapes = 30;
+};
+
+/// A rendered scene together with its ground truth.
+struct CheckerScene
+{
+    cv::Mat3b                image;
+    cv::Mat3b                patch_colors;  ///< 4x6 BGR as rendered, including the color cast.
+    std::vector<cv::Point2f> patch_centers; ///< Row by row, in image coordinates.
+    cv::Matx33d              homography;    ///< From checker coordinates to image coordinates.
+    cv::Vec3f                color_gains;   ///< Per channel (BGR) illumination gains.
+    float                    blur_sigma = 0;
+};
+
+/**
+ * @brief Render a colorchecker into a cluttered scene.
+ *
+ * Everything random is drawn from the seed, so the same seed always gives the same scene
+ * and scenes can be rendered in parallel.
+ */
+CheckerScene renderCheckerScene(const CheckerSceneParams& params, uint64_t seed);
+
+/// Ground truth as JSON, without the image.
+Json checkerSceneToJson(const CheckerScene& scene);
+
+} // namespace komb
@@ -0,0 +1,47 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include <opencv2/core.hpp>
+
+#include <color_calibration/ColorCalibration.hpp>
+
+#include "CheckerScene.hpp"
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(checker_generator)
+
+BOOST_AUTO_TEST_CASE(SameSeedSameScene)
+{
+    komb::CheckerSceneParams params;
+    params.image_size = cv::Size(320, 240);
+
+    const auto a = komb::renderCheckerScene(params, 17);
+    const auto b = komb::renderCheckerScene(params, 17);
+    const auto c = komb::renderCheckerScene(params, 18);
+    BOOST_CHECK_EQUAL(cv::norm(a.image, b.image, cv::NORM_INF), 0.0);
+    BOOST_CHECK(cv::norm(a.image, c.image, cv::NORM_INF) > 0.0);
+    BOOST_CHECK_EQUAL(a.patch_centers.size(), 24u);
+}
+
+BOOST_AUTO_TEST_CASE(FindColorCheckerInCleanScene)
+{
+    komb::CheckerSceneParams params;
+    params.image_size = cv::Size(1080, 768);
+    params.min_checker_fraction = 0.8f;
+    params.max_checker_fraction = 0.8f;
+    params.max_rotation_deg = 0;
+    params.max_perspective = 0;
+    params.max_blur_sigma = 0;
+    params.noise_sigma = 1;
+    params.num_clutter_shapes = 0;
+
+    const auto scene = komb::renderCheckerScene(params, 0);
+    cv::Mat3b no_canvas;
+    const cv::Mat3b found_colors = komb::findColorChecker(scene.image, no_canvas);
+    BOOST_REQUIRE(!found_colors.empty());
+    BOOST_CHECK(cv::norm(found_colors, scene.patch_colors, cv::NORM_INF) < 8.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,7 +1,9 @@
 #include "ColorCalibration.hpp"
 
 #include <algorithm>
+#include <array>
 #include <functional>
+#include <numeric>
 #include <utility>
 #include <vector>
 
@@ -9,44 +11,67 @@
 
 #include <common/algorithm/Container.hpp>
 #include <common/algorithm/Range.hpp>
+#include <common/ArenaAllocator.hpp>
 #include <common/Logging.hpp>
 #include <common/Math.hpp>
+#include <common/Profiler.hpp>
 #include <common/String.hpp>
+#include <common/TaskScheduler.hpp>
+#include <image_toolbox/ContourFeatures.hpp>
 #include <image_toolbox/Magnitude.hpp>
 
 namespace komb {
 
-std::pair<std::vector<std::vector<cv::Point>>, std::vector<double>> findSquares(
-    const cv::Mat3b& image, cv::Mat3b& canvas)
+namespace {
+
+/// The four corners of a square found by findSquares.
+using Square = std::array<cv::Point, 4>;
+
+/// findSquares, appending to containers from the ScratchScope of a detection.
+void findSquares(const cv::Mat3b& image, cv::Mat3b& canvas,
+    ArenaVector<Square>& out_squares, ArenaVector<double>& out_sizes)
 {
+    PROFILE_STAGE(findSquares);
     CHECK(!image.empty());
 
+    // cv::findContours and cv::approxPolyDP need std::vectors, so these can not use an arena.
     std::vector<std::vector<cv::Point>> contours;
     cv::Mat areas = edgeMagnitude(image) <= 2;
-    cv::findContours(areas, contours, cv::RETR_LIST, cv::CHAIN_APPROX_TC89_L1);
+    {
+        PROFILE_STAGE(findContours);
+        cv::findContours(areas, contours, cv::RETR_LIST, cv::CHAIN_APPROX_TC89_L1);
+    }
 
     if (!canvas.empty())
     {
         cv::drawContours(canvas, contours, -1, cv::Scalar(255, 255, 255));
     }
 
-    std::vector<std::vector<cv::Point>> square_contours;
-    std::vector<double> square_sizes;
+    PROFILE_STAGE(filterContours);
+    ContourSoA contour_points;
+    // Reused for all contours.
+    std::vector<cv::Point> simple_contour;
     for (const auto& contour : contours)
     {
-        std::vector<cv::Point> simple_contour;
+        // Holes have negative area, check that before simplifying the contour.
+        contour_points.assign(contour);
+        double area = -contourShapeFeatures(contour_points).signed_area;
+        if (area <= 0)
+        {
+            continue;
+        }
+
         cv::approxPolyDP(contour, simple_contour, 15, true);
 
-        double area = -cv::contourArea(contour, true);
-        if (area > 0 && simple_contour.size() == 4)
+        if (simple_contour.size() == 4)
         {
-            std::vector<double> lengths(simple_contour.size());
-            for (const auto a : indices(simple_contour))
+            std::array<double, 4> lengths;
+            for (const auto a : indices(lengths))
             {
-                auto b = (a + 1) % simple_contour.size();
+                auto b = (a + 1) % lengths.size();
                 lengths[a] = cv::norm(simple_contour[a] - simple_contour[b]);
             }
-            double mean_length = cv::mean(lengths)[0];
+            double mean_length = std::accumulate(lengths.begin(), lengths.end(), 0.0) / lengths.size();
             bool mean_length_vs_area_ok = (std::abs(mean_length * mean_length - area) < area * 0.1);
 
             bool even_lengths = komb::all_of(lengths, [&mean_length](float length)
@@ -56,8 +81,9 @@ std::pair<std::vector<std::vector<cv::Point>>, std::vector<double>> findSquares(
 
             if (mean_length_vs_area_ok && even_lengths)
             {
-                square_contours.push_back(simple_contour);
-                square_sizes.push_back(mean_length);
+                out_squares.push_back(
+                    {{simple_contour[0], simple_contour[1], simple_contour[2], simple_contour[3]}});
+                out_sizes.push_back(mean_length);
             }
 
             if (!canvas.empty())
@@ -70,17 +96,37 @@ std::pair<std::vector<std::vector<cv::Point>>, std::vector<double>> findSquares(
             }
         }
     }
-    return {square_contours, square_sizes};
+}
+
+} // namespace
+
+std::pair<std::vector<std::vector<cv::Point>>, std::vector<double>> findSquares(
+    const cv::Mat3b& image, cv::Mat3b& canvas)
+{
+    ScratchScope scratch;
+    ArenaVector<Square> squares(scratch.resource());
+    ArenaVector<double> sizes(scratch.resource());
+    findSquares(image, canvas, squares, sizes);
+
+    std::vector<std::vector<cv::Point>> square_contours;
+    for (const auto& square : squares)
+    {
+        square_contours.emplace_back(square.begin(), square.end());
+    }
+    return {square_contours, std::vector<double>(sizes.begin(), sizes.end())};
 }
 
 cv::Mat3b findColorChecker(
     const cv::Mat3b& image, cv::Mat3b& canvas)
 {
+    PROFILE_STAGE(findColorChecker);
     CHECK(!image.empty());
 
-    std::vector<std::vector<cv::Point>> square_contours;
-    std::vector<double> square_sizes;
-    std::tie(square_contours, square_sizes) = findSquares(image, canvas);
+    // The temporaries of the detection come from the arena of this thread.
+    ScratchScope scratch;
+    ArenaVector<Square> square_contours(scratch.resource());
+    ArenaVector<double> square_sizes(scratch.resource());
+    findSquares(image, canvas, square_contours, square_sizes);
 
     if (square_sizes.size() == 0)
     {
@@ -94,16 +140,18 @@ cv::Mat3b findColorChecker(
 
     VLOG(1) << "Median square size: " << median_square_size;
 
-    std::vector<cv::Point> square_centers;
+    ArenaVector<cv::Point> square_centers(scratch.resource());
     cv::Vec2f x_axis;
     cv::Vec2f y_axis;
     for (const auto i : indices(square_sizes))
     {
         if (std::abs(square_sizes[i] - median_square_size) < median_square_size * 0.1)
         {
-            cv::Scalar center = cv::mean(square_contours[i]);
+            const Square& square = square_contours[i];
+            const double center_x = (square[0].x + square[1].x + square[2].x + square[3].x) / 4.0;
+            const double center_y = (square[0].y + square[1].y + square[2].y + square[3].y) / 4.0;
             square_centers.push_back(
-                cv::Point(komb::roundToInt(center[0]), komb::roundToInt(center[1])));
+                cv::Point(komb::roundToInt(center_x), komb::roundToInt(center_y)));
 
             for (int a = 0; a < 4; ++a)
             {
@@ -131,7 +179,8 @@ cv::Mat3b findColorChecker(
     cv::Mat1f map_from_image(2, 2);
     map_from_image << x_axis[0], x_axis[1], y_axis[0], y_axis[1];
 
-    std::vector<cv::Point2f> adjusted_centers;
+    ArenaVector<cv::Point2f> adjusted_centers(scratch.resource());
+    adjusted_centers.reserve(square_centers.size());
     for (const auto& center : square_centers)
     {
         cv::Mat1f adjusted = map_from_image * (cv::Mat1f(2, 1) << center.x, center.y);
@@ -169,23 +218,28 @@ cv::Mat3b findColorChecker(
     }
 
     // Fit a multivariate polynomial to get a function from row,col to image x,y.
-    cv::Mat1f AtA(6, 6, 0.f);
-    cv::Mat1f AtB(6, 2, 0.f);
-    for (const auto i : indices(square_centers))
+    cv::Mat1f transformation_parameters;
     {
-        float row = std::round(adjusted_centers[i].y);
-        float col = std::round(adjusted_centers[i].x);
-        cv::Mat1f A_row(1, 6);
-        A_row << 1, row, col, row * row, col * col, row * col;
-        cv::Mat1f xy(square_centers[i], true);
-        AtA += A_row.t() * A_row;
-        AtB += A_row.t() * xy.t();
+        PROFILE_STAGE(fitGrid);
+        cv::Mat1f AtA(6, 6, 0.f);
+        cv::Mat1f AtB(6, 2, 0.f);
+        for (const auto i : indices(square_centers))
+        {
+            float row = std::round(adjusted_centers[i].y);
+            float col = std::round(adjusted_centers[i].x);
+            cv::Mat1f A_row(1, 6);
+            A_row << 1, row, col, row * row, col * col, row * col;
+            cv::Mat1f xy(square_centers[i], true);
+            AtA += A_row.t() * A_row;
+            AtB += A_row.t() * xy.t();
+        }
+        transformation_parameters = AtA.inv() * AtB;
+        VLOG(2) << "AtA:\n" << AtA;
+        VLOG(2) << "AtB:\n" << AtB;
+        VLOG(2) << "Transformation parameters:\n" << transformation_parameters;
     }
-    cv::Mat1f transformation_parameters = AtA.inv() * AtB;
-    VLOG(2) << "AtA:\n" << AtA;
-    VLOG(2) << "AtB:\n" << AtB;
-    VLOG(2) << "Transformation parameters:\n" << transformation_parameters;
 
+    PROFILE_STAGE(sampleColors);
     cv::Mat3b ordered_colors(num_rows, num_cols);
     for (int row : irange(num_rows))
     {
@@ -232,6 +286,7 @@ cv::Matx34f findColorTransformation(
     const cv::Mat3b& camera_checker,
     const cv::Mat3b& reference_checker)
 {
+    PROFILE_STAGE(findColorTransformation);
     CHECK(!camera_checker.empty());
     CHECK(!reference_checker.empty());
     CHECK_EQ(camera_checker.size(), reference_checker.size());
@@ -260,21 +315,10 @@ cv::Matx34f findColorTransformation(
 void applyColorTransformation(
     cv::Mat3b& image, const cv::Matx34f& color_transformation)
 {
-    auto transform = [&color_transformation](cv::Vec3b cam_color)
-    {
-        cv::Vec4f A_row(cam_color[0], cam_color[1], cam_color[2], 1);
-        cv::Vec3f new_color = color_transformation * A_row;
-        return cv::Vec3b(
-            cv::saturate_cast<uchar>(new_color(0)),
-            cv::saturate_cast<uchar>(new_color(1)),
-            cv::saturate_cast<uchar>(new_color(2)));
-    };
-
-    int num_pixels = image.total();
-    for (int i = 0; i < num_pixels; ++i)
-    {
-        image(i) = transform(image(i));
-    }
+    PROFILE_STAGE(applyColorTransformation);
+    // cv::transform treats the last column as an offset and runs vectorized, which is
+    // several times faster than a per-pixel matrix multiplication.
+    cv::transform(image, image, color_transformation);
 }
 
 float medianAbsoluteDeviation(const cv::Mat& a, const cv::Mat& b)
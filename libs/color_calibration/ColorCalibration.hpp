@@ -1,9 +1,21 @@
 #pragma once
 
+#include <utility>
+#include <vector>
+
 #include <opencv2/core.hpp>
 
 namespace komb {
 
+/**
+ * @brief First step of findColorChecker: find contours that look like the squares of a colorchecker.
+ * @param image
+ * @param canvas Optional image where debug information will be drawn.
+ * @return Four corner contours of the squares and the mean side length of each square.
+ */
+std::pair<std::vector<std::vector<cv::Point>>, std::vector<double>> findSquares(
+    const cv::Mat3b& image, cv::Mat3b& canvas);
+
 /**
  * @brief Detect and find colors of the squares in a colorchecker camera calibration target.
  * @param image
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "MemoryResource.hpp"
+
+namespace komb {
+
+/**
+ * @brief Standard allocator on top of a MemoryResource, like std::pmr::polymorphic_allocator.
+ *
+ * Lets standard containers take their memory from a MonotonicArena or a ScratchScope:
+ *
+ *     ScratchScope scratch;
+ *     ArenaVector<float> xs(n, ArenaAllocator<float>(scratch.resource()));
+ *
+ * Copies of a container keep allocating from the same resource.
+ */
+template<typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    ArenaAllocator() : resource_(&defaultMemoryResource()) {}
+    ArenaAllocator(MemoryResource& resource) : resource_(&resource) {}
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : resource_(&other.resource()) {}
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, size_t n)
+    {
+        resource_->deallocate(pointer, n * sizeof(T), alignof(T));
+    }
+
+    MemoryResource& resource() const { return *resource_; }
+
+private:
+    MemoryResource* resource_;
+};
+
+template<typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return &a.resource() == &b.resource();
+}
+
+template<typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return !(a == b);
+}
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace komb
@@ -3,6 +3,7 @@
 #include <string>
 
 #include "Profiler.hpp"
+#include "TraceProfiler.hpp"
 
 namespace komb {
 
@@ -11,6 +12,7 @@ void setThreadName(const std::string& name)
 {
     loguru::set_thread_name(name.c_str());
     rmt_SetCurrentThreadName(name.c_str());
+    setTraceThreadName(name);
 }
 
 std::string stacktraceAndErrorContext(int skip)
@@ -20,6 +20,7 @@
 #include "Profiler.hpp"
 #include "ScopeExit.hpp"
 #include "String.hpp"
+#include "TraceProfiler.hpp"
 
 // From: https://github.com/BVLC/caffe/pull/891/files
 // gflags 2.1 issue: namespace google was changed to gflags without warning.
@@ -37,6 +38,9 @@ DEFINE_string(logdir, "~/volumental/logs/", "Specify where log files end up.");
 DEFINE_bool(throw_on_fatal , false, "Throw an exception of CHECK failures etc?");
 
 DEFINE_bool(profile, false, "Profile this app using Remotery?");
+DEFINE_bool(stage_timings, false, "Log timing histograms of all PROFILE_STAGE:s at exit?");
+DEFINE_string(trace_file, "",
+    "Write a Chrome trace of all PROFILE_STAGE:s here at exit and on SIGUSR1.");
 
 namespace fs = boost::filesystem;
 
@@ -186,6 +190,17 @@ void initLogging(int& argc, char**& argv, Arguments arguments) // NOLINT
     {
         startProfilerServer();
     }
+
+    if (FLAGS_stage_timings)
+    {
+        enableStageTimings();
+        atexit(logStageTimings);
+    }
+
+    if (!FLAGS_trace_file.empty())
+    {
+        startTracing(FLAGS_trace_file);
+    }
 }
 
 void initLoggingNoArgs(const char* app_name)
@@ -0,0 +1,160 @@
+#include "MemoryResource.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "Logging.hpp"
+
+namespace komb {
+
+namespace {
+
+class AlignedHeapResource : public MemoryResource
+{
+public:
+    void* allocate(size_t bytes, size_t alignment) override
+    {
+        void* pointer = nullptr;
+        // posix_memalign needs at least pointer alignment, and does not like zero sizes.
+        const size_t posix_alignment = std::max(alignment, sizeof(void*));
+        if (posix_memalign(&pointer, posix_alignment, std::max<size_t>(bytes, 1)) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        return pointer;
+    }
+
+    void deallocate(void* pointer, size_t, size_t) override
+    {
+        std::free(pointer);
+    }
+};
+
+} // namespace
+
+MemoryResource& defaultMemoryResource()
+{
+    static AlignedHeapResource resource;
+    return resource;
+}
+
+PoolMemoryResource::PoolMemoryResource(size_t max_cached_bytes, MemoryResource& upstream)
+    : max_cached_bytes_(max_cached_bytes)
+    , upstream_(upstream)
+{}
+
+PoolMemoryResource::~PoolMemoryResource()
+{
+    release();
+}
+
+void* PoolMemoryResource::allocate(size_t bytes, size_t alignment)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = free_blocks_.find(BlockKey{bytes, alignment});
+        if (it != free_blocks_.end())
+        {
+            void* pointer = it->second;
+            free_blocks_.erase(it);
+            cached_bytes_ -= bytes;
+            return pointer;
+        }
+    }
+    return upstream_.allocate(bytes, alignment);
+}
+
+void PoolMemoryResource::deallocate(void* pointer, size_t bytes, size_t alignment)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cached_bytes_ + bytes <= max_cached_bytes_)
+        {
+            free_blocks_.emplace(BlockKey{bytes, alignment}, pointer);
+            cached_bytes_ += bytes;
+            return;
+        }
+    }
+    upstream_.deallocate(pointer, bytes, alignment);
+}
+
+void PoolMemoryResource::release()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& block : free_blocks_)
+    {
+        upstream_.deallocate(block.second, block.first.first, block.first.second);
+    }
+    free_blocks_.clear();
+    cached_bytes_ = 0;
+}
+
+size_t PoolMemoryResource::cachedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cached_bytes_;
+}
+
+MonotonicArena::MonotonicArena(size_t initial_block_bytes, MemoryResource& upstream)
+    : initial_block_bytes_(std::max<size_t>(initial_block_bytes, kBlockAlignment))
+    , upstream_(upstream)
+{}
+
+MonotonicArena::~MonotonicArena()
+{
+    for (const Block& block : blocks_)
+    {
+        upstream_.deallocate(block.data, block.size, kBlockAlignment);
+    }
+}
+
+void* MonotonicArena::allocate(size_t bytes, size_t alignment)
+{
+    CHECK_F(alignment != 0 && (alignment & (alignment - 1)) == 0, "Bad alignment: %zu", alignment);
+    for (;;)
+    {
+        // Reuse the blocks after the current one before allocating a new one.
+        for (; current_block_ < blocks_.size(); ++current_block_, offset_ = 0)
+        {
+            const Block& block = blocks_[current_block_];
+            const auto start = reinterpret_cast<uintptr_t>(block.data);
+            const uintptr_t aligned = (start + offset_ + alignment - 1) & ~(alignment - 1);
+            if (aligned + bytes <= start + block.size)
+            {
+                offset_ = aligned + bytes - start;
+                return reinterpret_cast<void*>(aligned);
+            }
+        }
+
+        const size_t previous_size =
+            blocks_.empty() ? initial_block_bytes_ / 2 : blocks_.back().size;
+        const size_t size = std::max(2 * previous_size, bytes + alignment);
+        char* data = static_cast<char*>(upstream_.allocate(size, kBlockAlignment));
+        blocks_.push_back(Block{data, size});
+        current_block_ = blocks_.size() - 1;
+        offset_ = 0;
+    }
+}
+
+void MonotonicArena::rewind(const Marker& marker)
+{
+    CHECK_F(marker.block < current_block_ ||
+        (marker.block == current_block_ && marker.offset <= offset_),
+        "Can only rewind to an earlier position");
+    current_block_ = marker.block;
+    offset_ = marker.offset;
+}
+
+size_t MonotonicArena::capacity() const
+{
+    size_t result = 0;
+    for (const Block& block : blocks_)
+    {
+        result += block.size;
+    }
+    return result;
+}
+
+} // namespace komb
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace komb {
+
+/**
+ * @brief Source of raw memory for containers that take an allocator, like
+ * std::pmr::memory_resource in C++17.
+ *
+ * deallocate must be called with the same size and alignment as the matching allocate.
+ */
+class MemoryResource
+{
+public:
+    virtual ~MemoryResource() = default;
+
+    /// Never returns nullptr, throws std::bad_alloc instead.
+    virtual void* allocate(size_t bytes, size_t alignment) = 0;
+    virtual void deallocate(void* pointer, size_t bytes, size_t alignment) = 0;
+};
+
+/// Aligned heap allocation. Thread safe, lives for the whole program.
+MemoryResource& defaultMemoryResource();
+
+/**
+ * @brief Keeps freed blocks and hands them out again for allocations of the same size.
+ *
+ * Made for temporaries of the same size that are allocated over and over, e.g. the images
+ * of each video frame. Up to max_cached_bytes are kept, larger frees go back to upstream.
+ * Thread safe. Must outlive everything allocated from it.
+ */
+class PoolMemoryResource : public MemoryResource
+{
+public:
+    explicit PoolMemoryResource(
+        size_t max_cached_bytes, MemoryResource& upstream = defaultMemoryResource());
+    ~PoolMemoryResource() override;
+
+    PoolMemoryResource(const PoolMemoryResource&) = delete;
+    PoolMemoryResource& operator=(const PoolMemoryResource&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment) override;
+    void deallocate(void* pointer, size_t bytes, size_t alignment) override;
+
+    /// Return all cached blocks to upstream.
+    void release();
+
+    size_t cachedBytes() const;
+
+private:
+    using BlockKey = std::pair<size_t, size_t>; // bytes, alignment
+
+    const size_t                   max_cached_bytes_;
+    MemoryResource&                upstream_;
+    mutable std::mutex             mutex_;
+    std::multimap<BlockKey, void*> free_blocks_;
+    size_t                         cached_bytes_ = 0;
+};
+
+/**
+ * @brief Hands out memory by bumping a pointer, and frees it all at once.
+ *
+ * deallocate does nothing. The memory comes back with rewind() or reset(), which keep the
+ * blocks for reuse, so a warmed up arena does not allocate at all.
+ * Not thread safe. Must outlive everything allocated from it.
+ */
+class MonotonicArena : public MemoryResource
+{
+public:
+    /// The first block is allocated on first use. Later blocks double in size.
+    explicit MonotonicArena(
+        size_t initial_block_bytes = 64 * 1024, MemoryResource& upstream = defaultMemoryResource());
+    ~MonotonicArena() override;
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    void* allocate(size_t bytes, size_t alignment) override;
+    void deallocate(void*, size_t, size_t) override {}
+
+    struct Marker
+    {
+        size_t block;
+        size_t offset;
+    };
+
+    /// The current position, to rewind() to later.
+    Marker mark() const { return Marker{current_block_, offset_}; }
+
+    /// Frees everything allocated after marker was taken.
+    void rewind(const Marker& marker);
+
+    /// Frees everything.
+    void reset() { rewind(Marker{0, 0}); }
+
+    /// Total size of the blocks, used or not.
+    size_t capacity() const;
+
+private:
+    struct Block
+    {
+        char*  data;
+        size_t size;
+    };
+
+    static constexpr size_t kBlockAlignment = 64;
+
+    const size_t       initial_block_bytes_;
+    MemoryResource&    upstream_;
+    std::vector<Block> blocks_;
+    size_t             current_block_ = 0;
+    size_t             offset_ = 0;
+};
+
+} // namespace komb
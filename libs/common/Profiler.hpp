@@ -2,6 +2,9 @@
 
 #include <remotery/Remotery.h>
 
+#include "ScopeExit.hpp"
+#include "StageTimer.hpp"
+
 /*
 Basic use:
 
@@ -28,8 +31,24 @@ Start the app with --profile and open komb/thirdparty/Remotery/vis/index.html in
 If Remotery can't connect to your app, restart the app and try again.
 
 That's it!
+
+For pipeline stages, prefer PROFILE_STAGE(name). It is a Remotery sample that also
+records into an in-process histogram, which works without the websocket server.
+Run with --stage_timings to log the histograms at exit, and/or with --trace_file to get
+a timeline of every call (see TraceProfiler.hpp):
+
+cv::Mat3b findColorChecker(...)
+{
+    PROFILE_STAGE(findColorChecker);
+    ...
+}
 */
 
+#define PROFILE_STAGE(name)                                                                        \
+    rmt_ScopedCPUSample(name, 0);                                                                  \
+    static ::komb::StageStats& CONCATENATE(s_stage_stats_, __LINE__) = ::komb::stageStats(#name);  \
+    ::komb::ScopedStageTimer CONCATENATE(stage_timer_, __LINE__)(CONCATENATE(s_stage_stats_, __LINE__))
+
 namespace komb {
 
 /// called by initLogging if --profile
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "Logging.hpp"
+
+namespace komb {
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer thread and one consumer thread.
+ *
+ * tryPush and tryPop never block or allocate. They return false when the queue is full or
+ * empty respectively, and it is up to the caller to decide whether to spin, yield or drop.
+ *
+ * Example:
+ *
+ *     SpscQueue<cv::Mat> queue(8);
+ *
+ *     // Producer thread:
+ *     while (!queue.tryPush(std::move(frame))) { std::this_thread::yield(); }
+ *
+ *     // Consumer thread:
+ *     cv::Mat frame;
+ *     while (!queue.tryPop(frame)) { std::this_thread::yield(); }
+ */
+template<typename T>
+class SpscQueue
+{
+public:
+    /// One extra slot is allocated so that a full queue can be told apart from an empty one.
+    explicit SpscQueue(size_t capacity) : slots_(capacity + 1)
+    {
+        CHECK_GT(capacity, 0u);
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /// Only call from the producer thread. On failure value is left untouched.
+    bool tryPush(T&& value)
+    {
+        const size_t tail = tail_.value.load(std::memory_order_relaxed);
+        const size_t next_tail = increment(tail);
+        if (next_tail == head_.value.load(std::memory_order_acquire))
+        {
+            return false; // Full.
+        }
+        slots_[tail] = std::move(value);
+        tail_.value.store(next_tail, std::memory_order_release);
+        return true;
+    }
+
+    /// Only call from the consumer thread.
+    bool tryPop(T& out_value)
+    {
+        const size_t head = head_.value.load(std::memory_order_relaxed);
+        if (head == tail_.value.load(std::memory_order_acquire))
+        {
+            return false; // Empty.
+        }
+        out_value = std::move(slots_[head]);
+        head_.value.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    /// Approximate when called while the other thread is active.
+    size_t size() const
+    {
+        const size_t head = head_.value.load(std::memory_order_acquire);
+        const size_t tail = tail_.value.load(std::memory_order_acquire);
+        return tail >= head ? tail - head : tail + slots_.size() - head;
+    }
+
+    size_t capacity() const { return slots_.size() - 1; }
+
+private:
+    size_t increment(size_t index) const
+    {
+        return index + 1 == slots_.size() ? 0 : index + 1;
+    }
+
+    // The head and tail are written by different threads, so keep them on separate cache lines.
+    static const size_t kCacheLineSize = 64;
+
+    struct PaddedIndex
+    {
+        std::atomic<size_t> value{0};
+        char padding[kCacheLineSize - sizeof(std::atomic<size_t>)];
+    };
+
+    std::vector<T> slots_;
+    PaddedIndex    head_; ///< Next slot to pop. Written by the consumer.
+    PaddedIndex    tail_; ///< Next slot to push. Written by the producer.
+};
+
+} // namespace komb
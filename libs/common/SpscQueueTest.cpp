@@ -0,0 +1,78 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "SpscQueue.hpp"
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(common)
+
+BOOST_AUTO_TEST_CASE(SpscQueueFifo)
+{
+    komb::SpscQueue<int> queue(3);
+    BOOST_CHECK_EQUAL(queue.capacity(), 3u);
+    BOOST_CHECK_EQUAL(queue.size(), 0u);
+
+    int value = -1;
+    BOOST_CHECK(!queue.tryPop(value));
+
+    BOOST_CHECK(queue.tryPush(1));
+    BOOST_CHECK(queue.tryPush(2));
+    BOOST_CHECK(queue.tryPush(3));
+    BOOST_CHECK(!queue.tryPush(4));
+    BOOST_CHECK_EQUAL(queue.size(), 3u);
+
+    BOOST_CHECK(queue.tryPop(value));
+    BOOST_CHECK_EQUAL(value, 1);
+    BOOST_CHECK(queue.tryPush(4));
+
+    for (int expected : {2, 3, 4})
+    {
+        BOOST_CHECK(queue.tryPop(value));
+        BOOST_CHECK_EQUAL(value, expected);
+    }
+    BOOST_CHECK(!queue.tryPop(value));
+    BOOST_CHECK_EQUAL(queue.size(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(SpscQueueTwoThreads)
+{
+    const int kNumValues = 100000;
+    komb::SpscQueue<std::vector<int>> queue(4);
+
+    std::thread producer([&]()
+    {
+        for (int i = 0; i < kNumValues; ++i)
+        {
+            std::vector<int> value{i};
+            while (!queue.tryPush(std::move(value)))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int num_out_of_order = 0;
+    for (int i = 0; i < kNumValues; ++i)
+    {
+        std::vector<int> value;
+        while (!queue.tryPop(value))
+        {
+            std::this_thread::yield();
+        }
+        if (value.size() != 1 || value[0] != i)
+        {
+            num_out_of_order += 1;
+        }
+    }
+    producer.join();
+
+    BOOST_CHECK_EQUAL(num_out_of_order, 0);
+    BOOST_CHECK_EQUAL(queue.size(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,126 @@
+#include "StageTimer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "Logging.hpp"
+
+namespace komb {
+
+namespace {
+
+std::atomic<bool> s_stage_timings_enabled{false};
+
+// Leaked on purpose: stages are used from static destructors and logged from atexit.
+std::mutex& registryMutex()
+{
+    static auto* s_mutex = new std::mutex();
+    return *s_mutex;
+}
+
+std::vector<StageStats*>& registry()
+{
+    static auto* s_registry = new std::vector<StageStats*>();
+    return *s_registry;
+}
+
+int bucketIndex(uint64_t duration_ns)
+{
+    return 63 - __builtin_clzll(duration_ns | 1);
+}
+
+} // namespace
+
+StageStats::StageStats(const char* name) : name_(name)
+{
+    for (auto& bucket : buckets_)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void StageStats::add(uint64_t duration_ns)
+{
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_ns_.fetch_add(duration_ns, std::memory_order_relaxed);
+    buckets_[static_cast<size_t>(bucketIndex(duration_ns))].fetch_add(1, std::memory_order_relaxed);
+    uint64_t max_ns = max_ns_.load(std::memory_order_relaxed);
+    while (duration_ns > max_ns &&
+           !max_ns_.compare_exchange_weak(max_ns, duration_ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+uint64_t StageStats::quantileNs(double quantile) const
+{
+    const auto target = static_cast<uint64_t>(quantile * static_cast<double>(count()));
+    uint64_t seen = 0;
+    for (int i = 0; i < kNumBuckets - 1; ++i)
+    {
+        seen += buckets_[static_cast<size_t>(i)].load(std::memory_order_relaxed);
+        if (seen > target)
+        {
+            return uint64_t(1) << (i + 1);
+        }
+    }
+    return maxNs();
+}
+
+StageStats& stageStats(const char* name)
+{
+    std::lock_guard<std::mutex> lock(registryMutex());
+    for (StageStats* stage : registry())
+    {
+        if (std::strcmp(stage->name(), name) == 0)
+        {
+            return *stage;
+        }
+    }
+    registry().push_back(new StageStats(name));
+    return *registry().back();
+}
+
+void enableStageTimings()
+{
+    s_stage_timings_enabled.store(true, std::memory_order_relaxed);
+}
+
+bool stageTimingsEnabled()
+{
+    return s_stage_timings_enabled.load(std::memory_order_relaxed);
+}
+
+void logStageTimings()
+{
+    std::vector<StageStats*> stages;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        stages = registry();
+    }
+    std::sort(stages.begin(), stages.end(), [](const StageStats* a, const StageStats* b)
+    {
+        return a->totalNs() > b->totalNs();
+    });
+
+    LOG_F(INFO, "Stage timings (quantiles are power-of-two upper bounds):");
+    LOG_F(INFO, "%-28s %9s %11s %10s %10s %10s %10s", "stage", "count", "total ms", "mean ms",
+        "p50 ms", "p99 ms", "max ms");
+    for (const StageStats* stage : stages)
+    {
+        const uint64_t count = stage->count();
+        if (count == 0)
+        {
+            continue;
+        }
+        const double total_ms = 1e-6 * static_cast<double>(stage->totalNs());
+        LOG_F(INFO, "%-28s %9llu %11.3f %10.4f %10.4f %10.4f %10.4f", stage->name(),
+            static_cast<unsigned long long>(count), total_ms, total_ms / static_cast<double>(count),
+            1e-6 * static_cast<double>(stage->quantileNs(0.5)),
+            1e-6 * static_cast<double>(stage->quantileNs(0.99)),
+            1e-6 * static_cast<double>(stage->maxNs()));
+    }
+}
+
+} // namespace komb
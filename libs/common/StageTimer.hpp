@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "TraceProfiler.hpp"
+
+namespace komb {
+
+/**
+ * @brief Lock-free timing statistics for one named stage of a pipeline.
+ *
+ * Keeps a count, total, max and a histogram with power-of-two nanosecond buckets.
+ * Get instances through stageStats() so that they are registered for logStageTimings().
+ */
+class StageStats
+{
+public:
+    static const int kNumBuckets = 64; ///< Bucket i holds durations in [2^i, 2^(i+1)) ns.
+
+    explicit StageStats(const char* name);
+
+    StageStats(const StageStats&) = delete;
+    StageStats& operator=(const StageStats&) = delete;
+
+    void add(uint64_t duration_ns);
+
+    const char* name() const { return name_; }
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t totalNs() const { return total_ns_.load(std::memory_order_relaxed); }
+    uint64_t maxNs() const { return max_ns_.load(std::memory_order_relaxed); }
+
+    /// Upper bound of the bucket containing the given quantile, in nanoseconds.
+    uint64_t quantileNs(double quantile) const;
+
+private:
+    const char*                                   name_;
+    std::atomic<uint64_t>                         count_{0};
+    std::atomic<uint64_t>                         total_ns_{0};
+    std::atomic<uint64_t>                         max_ns_{0};
+    std::array<std::atomic<uint64_t>, kNumBuckets> buckets_;
+};
+
+/// Returns the stats for the given stage name, creating them on first use. Never destroyed.
+StageStats& stageStats(const char* name);
+
+/// Stage timing is off by default so that instrumented code only pays for a relaxed load.
+void enableStageTimings();
+bool stageTimingsEnabled();
+
+/// Log a table with all stages that have been run so far. Called at exit with --stage_timings.
+void logStageTimings();
+
+/// Times the enclosing scope into a StageStats, and into the trace if tracing is enabled.
+class ScopedStageTimer
+{
+public:
+    explicit ScopedStageTimer(StageStats& stats)
+        : stats_(stageTimingsEnabled() ? &stats : nullptr)
+        , trace_name_(tracingEnabled() ? stats.name() : nullptr)
+    {
+        if (stats_ || trace_name_)
+        {
+            start_ns_ = traceClockNs();
+        }
+    }
+
+    ~ScopedStageTimer()
+    {
+        if (stats_ || trace_name_)
+        {
+            const uint64_t end_ns = traceClockNs();
+            if (stats_)
+            {
+                stats_->add(end_ns - start_ns_);
+            }
+            if (trace_name_)
+            {
+                recordTraceEvent(trace_name_, start_ns_, end_ns);
+            }
+        }
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+    StageStats* stats_;
+    const char* trace_name_;
+    uint64_t    start_ns_ = 0;
+};
+
+} // namespace komb
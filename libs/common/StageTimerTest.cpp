@@ -0,0 +1,29 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "StageTimer.hpp"
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(common)
+
+BOOST_AUTO_TEST_CASE(StageStatsHistogram)
+{
+    komb::StageStats& stats = komb::stageStats("StageStatsHistogram");
+    BOOST_CHECK_EQUAL(&stats, &komb::stageStats("StageStatsHistogram"));
+
+    for (int i = 0; i < 99; ++i)
+    {
+        stats.add(1000); // In [512, 1024)
+    }
+    stats.add(1000000);
+
+    BOOST_CHECK_EQUAL(stats.count(), 100u);
+    BOOST_CHECK_EQUAL(stats.totalNs(), 99u * 1000u + 1000000u);
+    BOOST_CHECK_EQUAL(stats.maxNs(), 1000000u);
+    BOOST_CHECK_EQUAL(stats.quantileNs(0.5), 1024u);
+    BOOST_CHECK_EQUAL(stats.quantileNs(0.995), 1048576u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
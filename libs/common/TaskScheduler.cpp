@@ -0,0 +1,259 @@
+#include "TaskScheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <string>
+
+#include "Logging.hpp"
+
+namespace komb {
+
+namespace {
+
+/// The state of one parallelFor call, shared by the threads helping with it.
+struct Batch
+{
+    Batch(size_t n_arg, size_t chunk_size_arg, const TaskScheduler::RangeFunction& f_arg)
+        : n(n_arg)
+        , chunk_size(chunk_size_arg)
+        , num_chunks((n_arg + chunk_size_arg - 1) / chunk_size_arg)
+        , f(f_arg)
+    {}
+
+    /// Run chunks until all are taken. f is only touched while chunks remain, and parallelFor
+    /// does not return before they are done, so the reference to f stays valid.
+    void work()
+    {
+        for (;;)
+        {
+            const size_t chunk = next_chunk.fetch_add(1);
+            if (chunk >= num_chunks)
+            {
+                return;
+            }
+
+            std::exception_ptr chunk_error;
+            try
+            {
+                f(chunk * chunk_size, std::min(n, (chunk + 1) * chunk_size));
+            }
+            catch (...)
+            {
+                chunk_error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (chunk_error && !error)
+            {
+                error = chunk_error;
+            }
+            num_done += 1;
+            if (num_done == num_chunks)
+            {
+                all_done.notify_all();
+            }
+        }
+    }
+
+    const size_t                        n;
+    const size_t                        chunk_size;
+    const size_t                        num_chunks;
+    const TaskScheduler::RangeFunction& f;
+    std::atomic<size_t>                 next_chunk{0};
+
+    std::mutex                          mutex;
+    std::condition_variable             all_done;
+    size_t                              num_done = 0;
+    std::exception_ptr                  error;
+};
+
+/// Which scheduler and queue the calling thread works for, if it is a worker.
+thread_local const TaskScheduler* t_scheduler = nullptr;
+thread_local size_t               t_queue_index = 0;
+
+std::atomic<size_t> s_global_num_threads{0};
+std::atomic<bool>   s_global_scheduler_created{false};
+
+} // namespace
+
+TaskScheduler::TaskScheduler(size_t num_threads)
+{
+    if (num_threads == 0)
+    {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        queues_.push_back(std::make_unique<TaskQueue>());
+    }
+    for (size_t i = 0; i + 1 < num_threads; ++i)
+    {
+        workers_.emplace_back(&TaskScheduler::workerLoop, this, i);
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    task_added_.notify_all();
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void TaskScheduler::parallelFor(size_t n, size_t min_chunk, const RangeFunction& f)
+{
+    if (n == 0)
+    {
+        return;
+    }
+
+    // A few chunks per thread, so that a slow chunk does not hold up the whole loop.
+    const size_t target_num_chunks = 4 * numThreads();
+    const size_t chunk_size =
+        std::max(std::max<size_t>(min_chunk, 1), (n + target_num_chunks - 1) / target_num_chunks);
+    if (workers_.empty() || chunk_size >= n)
+    {
+        f(0, n);
+        return;
+    }
+
+    const auto batch = std::make_shared<Batch>(n, chunk_size, f);
+    const size_t num_helpers = std::min(workers_.size(), batch->num_chunks - 1);
+    for (size_t i = 0; i < num_helpers; ++i)
+    {
+        push([batch]() { batch->work(); });
+    }
+
+    batch->work();
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->all_done.wait(lock, [&batch]() { return batch->num_done == batch->num_chunks; });
+    if (batch->error)
+    {
+        std::rethrow_exception(batch->error);
+    }
+}
+
+void TaskScheduler::parallelFor2d(size_t width, size_t height, size_t tile_width,
+    size_t tile_height, const TileFunction& f)
+{
+    CHECK_GT(tile_width, 0u);
+    CHECK_GT(tile_height, 0u);
+    const size_t num_tiles_x = (width + tile_width - 1) / tile_width;
+    const size_t num_tiles_y = (height + tile_height - 1) / tile_height;
+    parallelFor(num_tiles_x * num_tiles_y, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const size_t x_begin = (i % num_tiles_x) * tile_width;
+            const size_t y_begin = (i / num_tiles_x) * tile_height;
+            f(Tile{x_begin, std::min(width, x_begin + tile_width),
+                y_begin, std::min(height, y_begin + tile_height)});
+        }
+    });
+}
+
+void TaskScheduler::push(Task task)
+{
+    // Count the task before it can be taken, so that num_pending_ never goes below zero.
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        num_pending_ += 1;
+    }
+    const size_t queue_index = t_scheduler == this ? t_queue_index : queues_.size() - 1;
+    TaskQueue& queue = *queues_[queue_index];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    task_added_.notify_one();
+}
+
+bool TaskScheduler::tryTake(size_t own_queue, Task& out_task)
+{
+    bool found = false;
+    {
+        // Newest first from our own queue, since its data is most likely still in cache.
+        TaskQueue& queue = *queues_[own_queue];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            out_task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            found = true;
+        }
+    }
+    for (size_t i = 1; !found && i < queues_.size(); ++i)
+    {
+        // Oldest first from the others, which tends to be the largest piece of work.
+        TaskQueue& queue = *queues_[(own_queue + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            out_task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            found = true;
+        }
+    }
+    if (found)
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        num_pending_ -= 1;
+    }
+    return found;
+}
+
+void TaskScheduler::workerLoop(size_t queue_index)
+{
+    setThreadName("task worker " + std::to_string(queue_index));
+    t_scheduler = this;
+    t_queue_index = queue_index;
+
+    for (;;)
+    {
+        Task task;
+        if (tryTake(queue_index, task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        task_added_.wait(lock, [this]() { return stop_ || num_pending_ > 0; });
+        if (stop_ && num_pending_ == 0)
+        {
+            return;
+        }
+    }
+}
+
+void setGlobalTaskSchedulerThreads(size_t num_threads)
+{
+    CHECK_F(!s_global_scheduler_created,
+        "setGlobalTaskSchedulerThreads must be called before globalTaskScheduler");
+    s_global_num_threads = num_threads;
+}
+
+TaskScheduler& globalTaskScheduler()
+{
+    static TaskScheduler scheduler([]()
+    {
+        s_global_scheduler_created = true;
+        return s_global_num_threads.load();
+    }());
+    return scheduler;
+}
+
+MonotonicArena& threadScratchArena()
+{
+    thread_local MonotonicArena arena;
+    return arena;
+}
+
+} // namespace komb
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MemoryResource.hpp"
+
+namespace komb {
+
+/**
+ * @brief Work-stealing scheduler for data parallel loops.
+ *
+ * Each worker has its own task queue. It takes the newest task from its own queue, and steals
+ * the oldest task from another queue when its own is empty. Threads that are not workers push
+ * to a shared queue that all workers steal from.
+ *
+ * parallelFor splits a range into chunks that the workers and the calling thread take turns
+ * to grab. The caller keeps working until every chunk is taken, so nested calls from inside a
+ * chunk can not deadlock, they just get less help.
+ *
+ * Use globalTaskScheduler() rather than creating more schedulers, so that parallel kernels in
+ * different libraries share the same threads instead of oversubscribing the cores.
+ */
+class TaskScheduler
+{
+public:
+    using RangeFunction = std::function<void(size_t begin, size_t end)>;
+
+    /// A rectangle of pixels [x_begin, x_end) x [y_begin, y_end).
+    struct Tile
+    {
+        size_t x_begin;
+        size_t x_end;
+        size_t y_begin;
+        size_t y_end;
+    };
+
+    using TileFunction = std::function<void(const Tile& tile)>;
+
+    /// num_threads includes the calling thread, so num_threads - 1 workers are started.
+    /// 0 means one thread per core.
+    explicit TaskScheduler(size_t num_threads = 0);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    /// Including the calling thread.
+    size_t numThreads() const { return workers_.size() + 1; }
+
+    /// Calls f(begin, end) for consecutive chunks covering [0, n), each of at least min_chunk
+    /// elements except maybe the last. Returns when all chunks are done.
+    /// The first exception thrown by f is rethrown here, after the other chunks have finished.
+    void parallelFor(size_t n, size_t min_chunk, const RangeFunction& f);
+
+    /// Calls f for tiles of at most tile_width x tile_height covering a width x height image.
+    /// Tiles keep the working set of each task in cache, unlike whole rows of a large image.
+    void parallelFor2d(size_t width, size_t height, size_t tile_width, size_t tile_height,
+        const TileFunction& f);
+
+private:
+    using Task = std::function<void()>;
+
+    struct TaskQueue
+    {
+        std::mutex       mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(Task task);
+    bool tryTake(size_t own_queue, Task& out_task);
+    void workerLoop(size_t queue_index);
+
+    /// One per worker, plus the shared one last.
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+
+    std::mutex               sleep_mutex_;
+    std::condition_variable  task_added_;
+    size_t                   num_pending_ = 0; ///< Pushed but not yet taken.
+    bool                     stop_ = false;
+    std::vector<std::thread> workers_;
+};
+
+/// Call before the first use of globalTaskScheduler(), e.g. from main.
+/// 0 means one thread per core, which is also the default.
+void setGlobalTaskSchedulerThreads(size_t num_threads);
+
+/// Created on first use and shared by the whole process.
+TaskScheduler& globalTaskScheduler();
+
+/// Scratch memory of the calling thread. Prefer ScratchScope, which frees it again.
+MonotonicArena& threadScratchArena();
+
+/**
+ * @brief Temporary memory from the arena of the calling thread, freed when the scope ends.
+ *
+ * Scopes nest, so a parallelFor chunk can use one inside another one. Everything allocated
+ * from resource() must be destroyed before the scope, e.g. by declaring it after the scope:
+ *
+ *     ScratchScope scratch;
+ *     Imagef gradient(width, height, kUninitialized, scratch.resource());
+ */
+class ScratchScope
+{
+public:
+    ScratchScope() : arena_(threadScratchArena()), marker_(arena_.mark()) {}
+    ~ScratchScope() { arena_.rewind(marker_); }
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    MemoryResource& resource() { return arena_; }
+
+private:
+    MonotonicArena&        arena_;
+    MonotonicArena::Marker marker_;
+};
+
+} // namespace komb
@@ -0,0 +1,154 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include "algorithm/Container.hpp"
+#include "ArenaAllocator.hpp"
+#include "TaskScheduler.hpp"
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(common)
+
+BOOST_AUTO_TEST_CASE(TaskSchedulerCoversRangeOnce)
+{
+    komb::TaskScheduler scheduler(4);
+    BOOST_CHECK_EQUAL(scheduler.numThreads(), 4u);
+
+    // Boost.Test assertions are not thread safe, so only check on the calling thread.
+    std::vector<int> visits(10007, 0);
+    std::atomic<int> num_empty_chunks{0};
+    scheduler.parallelFor(visits.size(), 100, [&](size_t begin, size_t end)
+    {
+        num_empty_chunks += begin < end ? 0 : 1;
+        for (size_t i = begin; i < end; ++i)
+        {
+            visits[i] += 1;
+        }
+    });
+    BOOST_CHECK_EQUAL(num_empty_chunks.load(), 0);
+    BOOST_CHECK(std::all_of(visits.begin(), visits.end(), [](int x) { return x == 1; }));
+}
+
+BOOST_AUTO_TEST_CASE(TaskSchedulerNestedAndExceptions)
+{
+    komb::TaskScheduler scheduler(3);
+    std::atomic<size_t> total{0};
+    scheduler.parallelFor(8, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            scheduler.parallelFor(100, 1, [&](size_t inner_begin, size_t inner_end)
+            {
+                total += inner_end - inner_begin;
+            });
+        }
+    });
+    BOOST_CHECK_EQUAL(total.load(), 800u);
+
+    BOOST_CHECK_THROW(scheduler.parallelFor(100, 1, [](size_t begin, size_t)
+    {
+        if (begin == 0) { throw std::runtime_error("first chunk"); }
+    }), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(TaskSchedulerTiles)
+{
+    komb::TaskScheduler scheduler(4);
+    const size_t kWidth = 100;
+    const size_t kHeight = 70;
+    std::vector<int> visits(kWidth * kHeight, 0);
+    std::atomic<int> num_bad_tiles{0};
+    scheduler.parallelFor2d(kWidth, kHeight, 32, 16, [&](const komb::TaskScheduler::Tile& tile)
+    {
+        const bool too_large = tile.x_end - tile.x_begin > 32 || tile.y_end - tile.y_begin > 16;
+        num_bad_tiles += too_large ? 1 : 0;
+        for (size_t y = tile.y_begin; y < tile.y_end; ++y)
+        {
+            for (size_t x = tile.x_begin; x < tile.x_end; ++x)
+            {
+                visits[y * kWidth + x] += 1;
+            }
+        }
+    });
+    BOOST_CHECK_EQUAL(num_bad_tiles.load(), 0);
+    BOOST_CHECK(std::all_of(visits.begin(), visits.end(), [](int x) { return x == 1; }));
+}
+
+BOOST_AUTO_TEST_CASE(ScratchScopesNest)
+{
+    komb::MonotonicArena& arena = komb::threadScratchArena();
+    const auto start = arena.mark();
+    void* inner_memory = nullptr;
+    {
+        komb::ScratchScope outer;
+        outer.resource().allocate(100, 8);
+        {
+            komb::ScratchScope inner;
+            inner_memory = inner.resource().allocate(1000, 64);
+            BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(inner_memory) % 64, 0u);
+        }
+        // The inner scope gave its memory back.
+        BOOST_CHECK_EQUAL(outer.resource().allocate(1000, 64), inner_memory);
+    }
+    BOOST_CHECK_EQUAL(arena.mark().block, start.block);
+    BOOST_CHECK_EQUAL(arena.mark().offset, start.offset);
+}
+
+BOOST_AUTO_TEST_CASE(ArenaVectorUsesScratch)
+{
+    komb::MonotonicArena arena(256);
+    {
+        komb::ArenaVector<int> values(arena);
+        for (int i = 0; i < 1000; ++i)
+        {
+            values.push_back(i);
+        }
+        // A copy keeps allocating from the same arena.
+        komb::ArenaVector<int> copy = values;
+        BOOST_CHECK(copy.get_allocator() == values.get_allocator());
+        BOOST_CHECK_EQUAL(std::accumulate(copy.begin(), copy.end(), 0), 999 * 1000 / 2);
+    }
+    BOOST_CHECK(arena.capacity() >= 2 * 1000 * sizeof(int));
+    arena.reset();
+
+    const std::vector<int> reference(1000, 7);
+    komb::ArenaVector<int> values(reference.begin(), reference.end(), arena);
+    BOOST_CHECK(std::equal(values.begin(), values.end(), reference.begin()));
+}
+
+BOOST_AUTO_TEST_CASE(ParallelContainerAlgorithms)
+{
+    std::vector<int> in(100000);
+    std::iota(in.begin(), in.end(), 0);
+    const auto is_odd = [](int x) { return x % 2 == 1; };
+
+    std::vector<int> squares(in.size());
+    komb::transform(komb::execution::par_unseq, in, squares, [](int x) { return x * 3; });
+    BOOST_CHECK_EQUAL(squares[99999], 299997);
+
+    std::vector<int> sums(in.size());
+    komb::transform(komb::execution::par, in, squares, sums, [](int a, int b) { return a + b; });
+    BOOST_CHECK_EQUAL(sums[1000], 4000);
+
+    BOOST_CHECK_EQUAL(komb::count_if(komb::execution::par, in, is_odd), 50000u);
+    BOOST_CHECK(komb::all_of(komb::execution::par, in, [](int x) { return x >= 0; }));
+    BOOST_CHECK(komb::none_of(komb::execution::par, in, [](int x) { return x < 0; }));
+
+    const std::vector<int> odd = komb::copy_if(komb::execution::par, in, is_odd);
+    BOOST_CHECK(odd == komb::copy_if(komb::execution::seq, in, is_odd));
+    BOOST_REQUIRE_EQUAL(odd.size(), 50000u);
+    BOOST_CHECK_EQUAL(odd[12345], 24691);
+
+    komb::fill(komb::execution::par, sums, 7);
+    BOOST_CHECK_EQUAL(komb::count(komb::execution::par, sums, 7), sums.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
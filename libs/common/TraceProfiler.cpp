@@ -0,0 +1,330 @@
+#include "TraceProfiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <csignal>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Logging.hpp"
+#include "ScopeExit.hpp"
+
+namespace komb {
+
+namespace {
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t    begin_ns;
+    uint64_t    end_ns;
+};
+
+/// Atomic so that writeTrace can read a slot while its thread overwrites it after a wrap-around.
+/// writeTrace drops the slots that may have been overwritten, see copyEvents.
+struct TraceSlot
+{
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint64_t>    begin_ns{0};
+    std::atomic<uint64_t>    end_ns{0};
+};
+
+/// Written by its own thread only.
+struct ThreadTraceBuffer
+{
+    std::vector<TraceSlot> slots = std::vector<TraceSlot>(kTraceEventsPerThread);
+    std::atomic<uint64_t>  num_written{0};
+    int                    thread_index = 0; ///< Guarded by registryMutex().
+    std::string            thread_name;      ///< Guarded by registryMutex().
+};
+
+std::atomic<bool> s_tracing_enabled{false};
+std::atomic<bool> s_write_requested{false};
+const uint64_t    s_clock_start_ns = traceClockNs();
+fs::path          s_trace_path;
+
+// Leaked on purpose: buffers of finished threads are still written at exit.
+std::mutex& registryMutex()
+{
+    static auto* s_mutex = new std::mutex();
+    return *s_mutex;
+}
+
+/// All buffers, including those of finished threads. Guarded by registryMutex().
+std::vector<ThreadTraceBuffer*>& registry()
+{
+    static auto* s_registry = new std::vector<ThreadTraceBuffer*>();
+    return *s_registry;
+}
+
+/// Buffers of finished threads, for new threads to reuse. Guarded by registryMutex().
+std::vector<ThreadTraceBuffer*>& freeBuffers()
+{
+    static auto* s_free_buffers = new std::vector<ThreadTraceBuffer*>();
+    return *s_free_buffers;
+}
+
+/// Guarded by registryMutex().
+int s_next_thread_index = 0;
+
+/// Serializes writeTrace, which may be called at exit, on SIGUSR1 and by the user.
+std::mutex& writeMutex()
+{
+    static auto* s_mutex = new std::mutex();
+    return *s_mutex;
+}
+
+/// The trace buffer of a thread, created by the first event it records, so that threads
+/// pay nothing while tracing is off. Given back to freeBuffers() when the thread exits.
+struct ThreadTraceState
+{
+    ~ThreadTraceState()
+    {
+        if (buffer)
+        {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            freeBuffers().push_back(buffer);
+        }
+    }
+
+    ThreadTraceBuffer* buffer = nullptr;
+    std::string        name;
+};
+
+ThreadTraceState& threadState()
+{
+    thread_local ThreadTraceState t_state;
+    return t_state;
+}
+
+ThreadTraceBuffer& threadBuffer()
+{
+    ThreadTraceState& state = threadState();
+    if (!state.buffer)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        if (freeBuffers().empty())
+        {
+            state.buffer = new ThreadTraceBuffer();
+            registry().push_back(state.buffer);
+        }
+        else
+        {
+            // The events of the finished thread are dropped, so memory stays bounded by the
+            // number of threads alive at the same time.
+            state.buffer = freeBuffers().back();
+            freeBuffers().pop_back();
+            state.buffer->num_written.store(0, std::memory_order_relaxed);
+        }
+        state.buffer->thread_index = s_next_thread_index++;
+        state.buffer->thread_name = state.name;
+    }
+    return *state.buffer;
+}
+
+/// Copy the events that buffer holds right now, except those that its thread may be
+/// overwriting while we read them. Call with registryMutex() locked.
+void copyEvents(const ThreadTraceBuffer& buffer, std::vector<std::pair<int, TraceEvent>>& out)
+{
+    const uint64_t end = buffer.num_written.load(std::memory_order_acquire);
+    const uint64_t begin = end > kTraceEventsPerThread ? end - kTraceEventsPerThread : 0;
+    const size_t first_copied = out.size();
+    for (uint64_t i = begin; i < end; ++i)
+    {
+        const TraceSlot& slot = buffer.slots[i % kTraceEventsPerThread];
+        out.emplace_back(buffer.thread_index, TraceEvent{
+            slot.name.load(std::memory_order_relaxed),
+            slot.begin_ns.load(std::memory_order_relaxed),
+            slot.end_ns.load(std::memory_order_relaxed)});
+    }
+
+    // If we read anything that recordTraceEvent wrote for event n, its release fence makes sure
+    // that we see num_written >= n below. Event n overwrites the slot of event n - size, so
+    // drop all events up to and including that one.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t end_after = buffer.num_written.load(std::memory_order_relaxed);
+    if (end_after + 1 > begin + kTraceEventsPerThread)
+    {
+        const uint64_t num_overwritten =
+            std::min(end - begin, end_after + 1 - kTraceEventsPerThread - begin);
+        out.erase(out.begin() + static_cast<std::ptrdiff_t>(first_copied),
+            out.begin() + static_cast<std::ptrdiff_t>(first_copied + num_overwritten));
+    }
+}
+
+void writeJsonString(FILE* file, const std::string& str)
+{
+    fputc('"', file);
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+        {
+            fputc('\\', file);
+        }
+        if (static_cast<unsigned char>(c) >= 0x20)
+        {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+void onSigusr1(int)
+{
+    s_write_requested.store(true); // Writing files is not async-signal-safe, so defer.
+}
+
+/// Polls for SIGUSR1 until stopped by writeTraceAtExit.
+struct WriteRequestPoller
+{
+    std::mutex              mutex;
+    std::condition_variable stop_requested;
+    bool                    stop = false;
+    std::thread             thread;
+};
+
+// Leaked on purpose, it is stopped by writeTraceAtExit.
+WriteRequestPoller* s_poller = nullptr;
+
+void pollForWriteRequests(WriteRequestPoller* poller)
+{
+    setThreadName("trace writer");
+    std::unique_lock<std::mutex> lock(poller->mutex);
+    while (!poller->stop_requested.wait_for(lock, std::chrono::milliseconds(100),
+        [poller]() { return poller->stop; }))
+    {
+        if (s_write_requested.exchange(false))
+        {
+            lock.unlock();
+            writeTrace(s_trace_path);
+            lock.lock();
+        }
+    }
+}
+
+void writeTraceAtExit()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_poller->mutex);
+        s_poller->stop = true;
+    }
+    s_poller->stop_requested.notify_all();
+    s_poller->thread.join();
+    writeTrace(s_trace_path);
+}
+
+} // namespace
+
+uint64_t traceClockNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool tracingEnabled()
+{
+    return s_tracing_enabled.load(std::memory_order_relaxed);
+}
+
+void enableTracing()
+{
+    s_tracing_enabled.store(true, std::memory_order_relaxed);
+}
+
+void startTracing(const fs::path& path)
+{
+    CHECK_F(!tracingEnabled(), "startTracing called twice");
+    s_trace_path = path;
+    enableTracing();
+    std::signal(SIGUSR1, onSigusr1);
+    s_poller = new WriteRequestPoller();
+    s_poller->thread = std::thread(pollForWriteRequests, s_poller);
+    atexit(writeTraceAtExit);
+    LOG_F(INFO, "Tracing to '%s'. Send SIGUSR1 to write it before exit.", path.c_str());
+}
+
+void recordTraceEvent(const char* name, uint64_t begin_ns, uint64_t end_ns)
+{
+    ThreadTraceBuffer& buffer = threadBuffer();
+    const uint64_t index = buffer.num_written.load(std::memory_order_relaxed);
+    TraceSlot& slot = buffer.slots[index % kTraceEventsPerThread];
+    // Lets copyEvents notice that it may have read a half overwritten slot. Free on x86.
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.begin_ns.store(begin_ns, std::memory_order_relaxed);
+    slot.end_ns.store(end_ns, std::memory_order_relaxed);
+    buffer.num_written.store(index + 1, std::memory_order_release);
+}
+
+void setTraceThreadName(const std::string& name)
+{
+    ThreadTraceState& state = threadState();
+    state.name = name;
+    if (state.buffer)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        state.buffer->thread_name = name;
+    }
+}
+
+bool writeTrace(const fs::path& path)
+{
+    std::lock_guard<std::mutex> write_lock(writeMutex());
+
+    // Copy the events first so that we hold the registry lock as short as possible.
+    std::vector<std::pair<int, std::string>> threads;
+    std::vector<std::pair<int, TraceEvent>> events;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        for (const ThreadTraceBuffer* buffer : registry())
+        {
+            threads.emplace_back(buffer->thread_index, buffer->thread_name);
+            copyEvents(*buffer, events);
+        }
+    }
+
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        LOG_F(ERROR, "Failed to open '%s' for writing the trace", path.c_str());
+        return false;
+    }
+    SCOPE_EXIT{ fclose(file); };
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto& thread : threads)
+    {
+        if (!thread.second.empty())
+        {
+            fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,"
+                "\"args\":{\"name\":", first ? "" : ",\n", thread.first);
+            writeJsonString(file, thread.second);
+            fprintf(file, "}}");
+            first = false;
+        }
+    }
+    for (const auto& event : events)
+    {
+        const TraceEvent& e = event.second;
+        fprintf(file, "%s{\"ph\":\"X\",\"name\":", first ? "" : ",\n");
+        writeJsonString(file, e.name);
+        fprintf(file, ",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", event.first,
+            1e-3 * static_cast<double>(e.begin_ns - s_clock_start_ns),
+            1e-3 * static_cast<double>(e.end_ns - e.begin_ns));
+        first = false;
+    }
+    fprintf(file, "\n]}\n");
+
+    LOG_F(INFO, "Wrote %zu trace events to '%s'", events.size(), path.c_str());
+    return true;
+}
+
+} // namespace komb
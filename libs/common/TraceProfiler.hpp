@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Path.hpp"
+
+/*
+Headless alternative to Remotery for when nobody can attach a browser.
+
+Every PROFILE_STAGE is recorded as a complete event into a per-thread ring buffer
+(no locks or allocations on the recording path). Start with --trace_file=trace.json and
+the trace is written at exit, or whenever the process receives SIGUSR1:
+
+    kill -USR1 <pid>
+
+Open the file in chrome://tracing or https://ui.perfetto.dev.
+*/
+
+namespace komb {
+
+/// Each thread keeps this many of its latest events.
+const size_t kTraceEventsPerThread = 1 << 16;
+
+/// Nanoseconds on the clock used for trace events.
+uint64_t traceClockNs();
+
+bool tracingEnabled();
+
+/// Start recording without writing anything automatically.
+void enableTracing();
+
+/// Start recording and write a Chrome trace to path at exit and on SIGUSR1.
+void startTracing(const fs::path& path);
+
+/// Lock-free. name must be a string literal or otherwise outlive the trace.
+void recordTraceEvent(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+/// Shown instead of the thread id in the trace viewer. Called by setThreadName.
+void setTraceThreadName(const std::string& name);
+
+/// Write all recorded events as Chrome trace JSON. Safe to call while other threads record.
+bool writeTrace(const fs::path& path);
+
+} // namespace komb
@@ -0,0 +1,104 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "Json.hpp"
+#include "Profiler.hpp"
+#include "TraceProfiler.hpp"
+
+namespace {
+
+void tracedFunction()
+{
+    PROFILE_STAGE(tracedFunction);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(common)
+
+BOOST_AUTO_TEST_CASE(ChromeTraceExport)
+{
+    komb::enableTracing();
+    tracedFunction();
+    std::thread([]()
+    {
+        komb::setThreadName("traced thread");
+        tracedFunction();
+        tracedFunction();
+    }).join();
+
+    const fs::path path = fs::temp_directory_path() / fs::unique_path("trace_%%%%%%%%.json");
+    BOOST_REQUIRE(komb::writeTrace(path));
+    const komb::Json trace = configuru::parse_file(path.string(), configuru::JSON);
+    fs::remove(path);
+
+    int num_traced = 0;
+    bool found_thread_name = false;
+    for (const komb::Json& event : trace["traceEvents"].as_array())
+    {
+        if (event["ph"] == "X" && event["name"] == "tracedFunction")
+        {
+            num_traced += 1;
+            BOOST_CHECK(static_cast<double>(event["dur"]) >= 0.0);
+        }
+        if (event["ph"] == "M" && event["args"]["name"] == "traced thread")
+        {
+            found_thread_name = true;
+        }
+    }
+    BOOST_CHECK_EQUAL(num_traced, 3);
+    BOOST_CHECK(found_thread_name);
+}
+
+BOOST_AUTO_TEST_CASE(ChromeTraceWhileRecording)
+{
+    komb::enableTracing();
+    const fs::path path = fs::temp_directory_path() / fs::unique_path("trace_%%%%%%%%.json");
+    const fs::path other_path =
+        fs::temp_directory_path() / fs::unique_path("trace_%%%%%%%%.json");
+
+    // Wrap around the ring buffer many times while the trace is written from two threads.
+    std::atomic<bool> done{false};
+    std::thread recorder([&done]()
+    {
+        for (uint64_t i = 0; i < 8 * komb::kTraceEventsPerThread; ++i)
+        {
+            komb::recordTraceEvent("wrapped", 1000 * i, 1000 * i + 1);
+        }
+        done = true;
+    });
+    std::thread other_writer([&done, &other_path]()
+    {
+        while (!done)
+        {
+            komb::writeTrace(other_path);
+        }
+    });
+    while (!done)
+    {
+        BOOST_REQUIRE(komb::writeTrace(path));
+        const komb::Json trace = configuru::parse_file(path.string(), configuru::JSON);
+        for (const komb::Json& event : trace["traceEvents"].as_array())
+        {
+            if (event["ph"] == "X" && event["name"] == "wrapped")
+            {
+                // Torn events would mix the begin and end of different events.
+                BOOST_REQUIRE_CLOSE(static_cast<double>(event["dur"]), 1e-3, 1e-3);
+            }
+        }
+    }
+    recorder.join();
+    other_writer.join();
+    fs::remove(path);
+    fs::remove(other_path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
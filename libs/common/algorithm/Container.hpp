@@ -2,12 +2,17 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstdint>
 #include <iterator>
 #include <numeric>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
 #include <common/Logging.hpp>
 
+#include "ExecutionPolicy.hpp"
 #include "Iterator.hpp"
 
 namespace komb {
@@ -66,8 +71,10 @@ void copy(const ContainerIn& in, ContainerOut& out)
     std::copy(begin(in), end(in), begin(out));
 }
 
+// Not callable with a policy, since copy_if(policy, in, predicate) would otherwise match it.
 template<typename ContainerIn, typename ContainerOut, typename Predicate>
-void copy_if(const ContainerIn& in, ContainerOut& out, Predicate predicate)
+auto copy_if(const ContainerIn& in, ContainerOut& out, Predicate predicate)
+    -> std::enable_if_t<!execution::IsPolicy<ContainerIn>::value>
 {
     using namespace std;
     DCHECK_EQ(size(in), size(out));
@@ -327,6 +334,161 @@ void generate(Container& io_container, Generator generator)
     std::generate(begin(io_container), end(io_container), generator);
 }
 
+// ----------------------------------------------------------------------------
+// Overloads taking an execution policy, see ExecutionPolicy.hpp.
+// The containers must have random access iterators.
+
+template<execution::Kind kKind, typename Container, typename UnaryFunction>
+void for_each(execution::Policy<kKind> policy, Container& io_container, UnaryFunction f)
+{
+    using namespace std;
+    const auto first = begin(io_container);
+    detail::forEachIndex(policy, size(io_container), [&](size_t i) { f(first[i]); });
+}
+
+template<execution::Kind kKind, typename Container, typename UnaryFunction>
+void for_each(execution::Policy<kKind> policy, const Container& container, UnaryFunction f)
+{
+    using namespace std;
+    const auto first = begin(container);
+    detail::forEachIndex(policy, size(container), [&](size_t i) { f(first[i]); });
+}
+
+template<execution::Kind kKind, typename ContainerIn, typename ContainerOut,
+    typename UnaryOperation>
+void transform(
+    execution::Policy<kKind> policy, const ContainerIn& in, ContainerOut& out, UnaryOperation op)
+{
+    using namespace std;
+    DCHECK_EQ(size(in), size(out));
+    const auto in_first = begin(in);
+    const auto out_first = begin(out);
+    detail::forEachIndex(policy, size(in), [&](size_t i) { out_first[i] = op(in_first[i]); });
+}
+
+template<execution::Kind kKind, typename ContainerIn1, typename ContainerIn2,
+    typename ContainerOut, typename BinaryOperation>
+void transform(execution::Policy<kKind> policy,
+    const ContainerIn1& in1, const ContainerIn2& in2, ContainerOut& out, BinaryOperation op)
+{
+    using namespace std;
+    DCHECK_EQ(size(in1), size(in2));
+    DCHECK_EQ(size(in2), size(out));
+    const auto in1_first = begin(in1);
+    const auto in2_first = begin(in2);
+    const auto out_first = begin(out);
+    detail::forEachIndex(policy, size(in1), [&](size_t i)
+    {
+        out_first[i] = op(in1_first[i], in2_first[i]);
+    });
+}
+
+template<execution::Kind kKind, typename ContainerIn, typename ContainerOut>
+void copy(execution::Policy<kKind> policy, const ContainerIn& in, ContainerOut& out)
+{
+    using namespace std;
+    DCHECK_EQ(size(in), size(out));
+    const auto in_first = begin(in);
+    const auto out_first = begin(out);
+    detail::forEachChunk(policy, size(in), [&](size_t chunk_begin, size_t chunk_end)
+    {
+        std::copy(in_first + chunk_begin, in_first + chunk_end, out_first + chunk_begin);
+    });
+}
+
+template<execution::Kind kKind, typename ContainerOut, typename Value>
+void fill(execution::Policy<kKind> policy, ContainerOut& out, const Value& value)
+{
+    using namespace std;
+    const auto out_first = begin(out);
+    detail::forEachChunk(policy, size(out), [&](size_t chunk_begin, size_t chunk_end)
+    {
+        std::fill(out_first + chunk_begin, out_first + chunk_end, value);
+    });
+}
+
+template<execution::Kind kKind, typename ContainerIn, typename Predicate>
+size_t count_if(execution::Policy<kKind> policy, const ContainerIn& in, Predicate predicate)
+{
+    using namespace std;
+    const auto in_first = begin(in);
+    std::atomic<size_t> total{0};
+    detail::forEachChunk(policy, size(in), [&](size_t chunk_begin, size_t chunk_end)
+    {
+        total += static_cast<size_t>(
+            std::count_if(in_first + chunk_begin, in_first + chunk_end, predicate));
+    });
+    return total;
+}
+
+template<execution::Kind kKind, typename Container, typename Value>
+size_t count(execution::Policy<kKind> policy, const Container& in, const Value& value)
+{
+    return count_if(policy, in, [&value](const auto& x) { return x == value; });
+}
+
+template<execution::Kind kKind, typename Container, typename Predicate>
+bool any_of(execution::Policy<kKind> policy, const Container& container, Predicate predicate)
+{
+    return count_if(policy, container, predicate) != 0;
+}
+
+template<execution::Kind kKind, typename Container, typename Predicate>
+bool all_of(execution::Policy<kKind> policy, const Container& container, Predicate predicate)
+{
+    return count_if(policy, container, predicate) == size(container);
+}
+
+template<execution::Kind kKind, typename Container, typename Predicate>
+bool none_of(execution::Policy<kKind> policy, const Container& container, Predicate predicate)
+{
+    return !any_of(policy, container, predicate);
+}
+
+/// Keeps the order of the elements. predicate is called exactly once per element.
+template<execution::Kind kKind, typename Container, typename Predicate>
+Container copy_if(execution::Policy<kKind> policy, const Container& in, Predicate predicate)
+{
+    using namespace std;
+    const size_t n = size(in);
+    const auto in_first = begin(in);
+
+    // Fixed blocks, so that the output offset of each block is known after the first pass.
+    const size_t kBlockSize = detail::kMinParallelChunk;
+    const size_t num_blocks = (n + kBlockSize - 1) / kBlockSize;
+    std::vector<uint8_t> keep(n);
+    std::vector<size_t> block_offsets(num_blocks + 1, 0);
+    detail::forEachIndex(policy, num_blocks, [&](size_t block)
+    {
+        const size_t block_end = std::min(n, (block + 1) * kBlockSize);
+        size_t num_kept = 0;
+        for (size_t i = block * kBlockSize; i < block_end; ++i)
+        {
+            keep[i] = predicate(in_first[i]) ? 1 : 0;
+            num_kept += keep[i];
+        }
+        block_offsets[block + 1] = num_kept;
+    }, 1);
+    std::partial_sum(block_offsets.begin(), block_offsets.end(), block_offsets.begin());
+
+    Container out;
+    out.resize(block_offsets.back());
+    const auto out_first = begin(out);
+    detail::forEachIndex(policy, num_blocks, [&](size_t block)
+    {
+        const size_t block_end = std::min(n, (block + 1) * kBlockSize);
+        size_t out_index = block_offsets[block];
+        for (size_t i = block * kBlockSize; i < block_end; ++i)
+        {
+            if (keep[i])
+            {
+                out_first[out_index++] = in_first[i];
+            }
+        }
+    }, 1);
+    return out;
+}
+
 // ----------------------------------------------------------------------------
 // Not part of <algorithm>, but nice to haves:
 
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+#include <common/TaskScheduler.hpp>
+
+// Lets the compiler vectorize a loop even where it can not prove that it is safe.
+#ifdef _OPENMP
+#define KOMB_PRAGMA_OMP_SIMD _Pragma("omp simd")
+#else
+#define KOMB_PRAGMA_OMP_SIMD
+#endif
+
+namespace komb {
+
+/**
+ * Execution policies for the container algorithms, like <execution> in C++17:
+ *
+ *     transform(execution::par_unseq, in, out, op);
+ *
+ * seq runs on the calling thread, exactly like the overloads without a policy.
+ * par splits the range in chunks that run on globalTaskScheduler(), so the operation must be safe
+ * to call from several threads at once.
+ * par_unseq additionally lets the compiler vectorize each chunk, so the operation must not
+ * synchronize with anything, e.g. lock a mutex.
+ */
+namespace execution {
+
+enum class Kind { kSequenced, kParallel, kParallelUnsequenced };
+
+template<Kind kKind>
+struct Policy
+{
+    static constexpr Kind kind = kKind;
+};
+
+using SequencedPolicy = Policy<Kind::kSequenced>;
+using ParallelPolicy = Policy<Kind::kParallel>;
+using ParallelUnsequencedPolicy = Policy<Kind::kParallelUnsequenced>;
+
+template<typename T>
+struct IsPolicy : std::false_type {};
+
+template<Kind kKind>
+struct IsPolicy<Policy<kKind>> : std::true_type {};
+
+constexpr SequencedPolicy seq{};
+constexpr ParallelPolicy par{};
+constexpr ParallelUnsequencedPolicy par_unseq{};
+
+} // namespace execution
+
+namespace detail {
+
+/// Smaller ranges are not worth waking up other threads for.
+constexpr size_t kMinParallelChunk = 4096;
+
+/// Calls f(begin, end) for chunks of at least min_chunk elements covering [0, n).
+template<execution::Kind kKind, typename RangeFunction>
+void forEachChunk(execution::Policy<kKind>, size_t n, const RangeFunction& f,
+    size_t min_chunk = kMinParallelChunk)
+{
+    if (kKind == execution::Kind::kSequenced || n <= min_chunk)
+    {
+        f(size_t(0), n);
+        return;
+    }
+    globalTaskScheduler().parallelFor(n, min_chunk, f);
+}
+
+/// Calls f(i) for all i in [0, n).
+template<execution::Kind kKind, typename IndexFunction>
+void forEachIndex(execution::Policy<kKind> policy, size_t n, const IndexFunction& f,
+    size_t min_chunk = kMinParallelChunk)
+{
+    forEachChunk(policy, n, [&f](size_t begin, size_t end)
+    {
+        if (kKind == execution::Kind::kParallelUnsequenced)
+        {
+            KOMB_PRAGMA_OMP_SIMD
+            for (size_t i = begin; i < end; ++i)
+            {
+                f(i);
+            }
+        }
+        else
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                f(i);
+            }
+        }
+    }, min_chunk);
+}
+
+/// Calls f(y) for all rows y in [0, rows) of an image with cols pixels per row,
+/// in chunks of at least kMinParallelChunk pixels.
+template<execution::Kind kKind, typename RowFunction>
+void forEachRow(execution::Policy<kKind> policy, size_t rows, size_t cols, const RowFunction& f)
+{
+    forEachChunk(policy, rows, [&f](size_t begin, size_t end)
+    {
+        for (size_t y = begin; y < end; ++y)
+        {
+            f(y);
+        }
+    }, std::max<size_t>(1, kMinParallelChunk / std::max<size_t>(1, cols)));
+}
+
+} // namespace detail
+
+} // namespace komb
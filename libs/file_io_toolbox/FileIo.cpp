@@ -1,5 +1,7 @@
 #include "FileIo.hpp"
 
+#include <sys/stat.h>
+
 #include <fstream>
 #include <string>
 #include <vector>
@@ -86,7 +88,6 @@ void writeBinaryFile(const fs::path& path, const void* data, size_t num_bytes)
 
 boost::optional<std::vector<uint8_t>> readBinaryFile(const fs::path& path)
 {
-    // This can be greatly optimized with fstat and/or mmap
     auto path_str = path.string();
     FILE* fp = fopen(path_str.c_str(), "rb");
     if (fp == nullptr)
@@ -96,10 +97,24 @@ boost::optional<std::vector<uint8_t>> readBinaryFile(const fs::path& path)
     }
     SCOPE_EXIT{ fclose(fp); };
 
-    const size_t kChunkSize = 64 * 1024;
-
     std::vector<uint8_t> bytes;
 
+    // Regular files are read with a single fread of the right size.
+    struct stat file_stat;
+    if (fstat(fileno(fp), &file_stat) == 0 && S_ISREG(file_stat.st_mode))
+    {
+        bytes.resize(static_cast<size_t>(file_stat.st_size));
+        bytes.resize(fread(bytes.data(), 1, bytes.size(), fp));
+        const int next_byte = fgetc(fp);
+        if (next_byte == EOF)
+        {
+            return bytes;
+        }
+        bytes.push_back(static_cast<uint8_t>(next_byte));
+    }
+
+    // Pipes and the like have no known size, and a regular file may have grown since fstat.
+    const size_t kChunkSize = 64 * 1024;
     for (;;)
     {
         bytes.resize(bytes.size() + kChunkSize);
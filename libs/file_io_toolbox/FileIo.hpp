@@ -20,6 +20,7 @@ boost::optional<std::string> readTextFile(const fs::path& path);
 void writeTextFile(const fs::path& path, const std::string& contents);
 
 void writeBinaryFile(const fs::path& path, const void* data, size_t num_bytes);
+/// Reads the whole file into memory. See MappedFile to read a file without copying it.
 boost::optional<std::vector<uint8_t>> readBinaryFile(const fs::path& path);
 
 template <typename T>
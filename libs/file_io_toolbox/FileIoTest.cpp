@@ -0,0 +1,100 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <common/ScopeExit.hpp>
+#include <file_io_toolbox/FileIo.hpp>
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(file_io_toolbox)
+
+namespace {
+
+/// Larger than the chunks readBinaryFile reads files of unknown size in.
+std::vector<uint8_t> testBytes()
+{
+    std::vector<uint8_t> bytes(200 * 1000);
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        bytes[i] = static_cast<uint8_t>(i * 13);
+    }
+    return bytes;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ReadBinaryFile)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("file_io_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    const std::vector<uint8_t> bytes = testBytes();
+    const fs::path path = temp_dir / "bytes.bin";
+    komb::writeBinaryFile(path, bytes.data(), bytes.size());
+    const auto read = komb::readBinaryFile(path);
+    BOOST_REQUIRE(read);
+    BOOST_CHECK(*read == bytes);
+
+    const fs::path empty_path = temp_dir / "empty.bin";
+    komb::writeBinaryFile(empty_path, nullptr, 0);
+    const auto empty = komb::readBinaryFile(empty_path);
+    BOOST_REQUIRE(empty);
+    BOOST_CHECK(empty->empty());
+
+    BOOST_CHECK(!komb::readBinaryFile(temp_dir / "missing.bin"));
+}
+
+BOOST_AUTO_TEST_CASE(ReadBinaryFileLongerThanItsSize)
+{
+    // Files in /proc are regular files of size zero, like a file that grew after fstat.
+    const fs::path path = "/proc/self/cmdline";
+    if (!fs::exists(path))
+    {
+        return;
+    }
+
+    std::ifstream stream(path.string(), std::ios::binary);
+    const std::vector<uint8_t> expected(
+        (std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    BOOST_REQUIRE(!expected.empty());
+
+    const auto read = komb::readBinaryFile(path);
+    BOOST_REQUIRE(read);
+    BOOST_CHECK(*read == expected);
+}
+
+BOOST_AUTO_TEST_CASE(ReadBinaryFileFromPipe)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("file_io_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    const fs::path path = temp_dir / "pipe";
+    BOOST_REQUIRE_EQUAL(::mkfifo(path.c_str(), 0600), 0);
+
+    const std::vector<uint8_t> bytes = testBytes();
+    std::thread writer([&]()
+    {
+        std::ofstream stream(path.string(), std::ios::binary);
+        stream.write(reinterpret_cast<const char*>(bytes.data()),
+            static_cast<std::streamsize>(bytes.size()));
+    });
+    const auto read = komb::readBinaryFile(path);
+    writer.join();
+
+    BOOST_REQUIRE(read);
+    BOOST_CHECK(*read == bytes);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
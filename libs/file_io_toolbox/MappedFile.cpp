@@ -0,0 +1,107 @@
+#include "MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <utility>
+
+#include <common/Debug.hpp>
+#include <common/ScopeExit.hpp>
+
+namespace komb {
+
+namespace {
+
+/// Hand error to the caller of MappedFile::open, which decides whether to log it.
+boost::none_t fail(std::string* out_error, const std::string& error)
+{
+    if (out_error != nullptr)
+    {
+        *out_error = error;
+    }
+    return boost::none;
+}
+
+} // namespace
+
+boost::optional<MappedFile> MappedFile::open(
+    const fs::path& path, FileAccess access, std::string* out_error)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return fail(out_error, "Failed to open '" + path.string() + "': " + komb::strerror());
+    }
+    SCOPE_EXIT{ ::close(fd); };
+
+    struct stat file_stat;
+    if (::fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+    {
+        return fail(out_error, "Can not map '" + path.string() + "', it is not a regular file");
+    }
+
+    const size_t size = static_cast<size_t>(file_stat.st_size);
+    if (size == 0)
+    {
+        // mmap does not accept empty ranges.
+        return MappedFile(nullptr, 0);
+    }
+
+    // The mapping stays valid after the file descriptor is closed.
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        return fail(out_error, "Failed to map '" + path.string() + "': " + komb::strerror());
+    }
+
+    if (access == FileAccess::kSequential)
+    {
+        ::madvise(data, size, MADV_SEQUENTIAL);
+        ::madvise(data, size, MADV_WILLNEED);
+    }
+    else
+    {
+        ::madvise(data, size, MADV_RANDOM);
+    }
+
+    return MappedFile(static_cast<const uint8_t*>(data), size);
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+    : data_(other.data_)
+    , size_(other.size_)
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+    if (this != &other)
+    {
+        unmap();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+void MappedFile::unmap()
+{
+    if (data_ != nullptr)
+    {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+} // namespace komb
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <boost/optional.hpp>
+
+#include <common/Path.hpp>
+
+namespace komb {
+
+/// How a MappedFile will be read, passed on to the kernel with madvise.
+enum class FileAccess
+{
+    kSequential, ///< Read ahead aggressively and drop pages behind the reader.
+    kRandom,     ///< No read-ahead.
+};
+
+/**
+ * @brief Read-only memory mapping of a whole file.
+ *
+ * The bytes are read straight from the page cache, without copying them into a buffer.
+ * The mapping is removed when the MappedFile is destroyed.
+ * The file must not be truncated by someone else while it is mapped.
+ */
+class MappedFile
+{
+public:
+    /// Returns boost::none if the file can not be opened or mapped, without logging.
+    /// The reason, e.g. the strerror of errno, is written to out_error if it is given.
+    static boost::optional<MappedFile> open(const fs::path& path,
+        FileAccess access = FileAccess::kSequential, std::string* out_error = nullptr);
+
+    MappedFile(MappedFile&& other);
+    MappedFile& operator=(MappedFile&& other);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+private:
+    MappedFile(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    void unmap();
+
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace komb
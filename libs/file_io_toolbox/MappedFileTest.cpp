@@ -0,0 +1,67 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <common/ScopeExit.hpp>
+#include <file_io_toolbox/FileIo.hpp>
+#include <file_io_toolbox/MappedFile.hpp>
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(file_io_toolbox)
+
+BOOST_AUTO_TEST_CASE(MappedFileMapsWholeFile)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("mapped_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    // Not a multiple of the page size.
+    std::vector<uint8_t> bytes(3 * 4096 + 17);
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        bytes[i] = static_cast<uint8_t>(i * 7);
+    }
+    const fs::path path = temp_dir / "bytes.bin";
+    komb::writeBinaryFile(path, bytes.data(), bytes.size());
+
+    for (const auto access : {komb::FileAccess::kSequential, komb::FileAccess::kRandom})
+    {
+        auto file = komb::MappedFile::open(path, access);
+        BOOST_REQUIRE(file);
+        BOOST_REQUIRE_EQUAL(file->size(), bytes.size());
+        BOOST_CHECK(!file->empty());
+        BOOST_CHECK(std::vector<uint8_t>(file->data(), file->data() + file->size()) == bytes);
+
+        // The mapping moves with the object.
+        const uint8_t* data = file->data();
+        komb::MappedFile moved = std::move(*file);
+        BOOST_CHECK(moved.data() == data);
+        BOOST_CHECK(file->data() == nullptr);
+        BOOST_CHECK(file->empty());
+    }
+
+    const fs::path empty_path = temp_dir / "empty.bin";
+    komb::writeBinaryFile(empty_path, nullptr, 0);
+    const auto empty = komb::MappedFile::open(empty_path);
+    BOOST_REQUIRE(empty);
+    BOOST_CHECK(empty->empty());
+
+    // Failures are not logged, the reason is returned instead.
+    std::string error;
+    BOOST_CHECK(!komb::MappedFile::open(temp_dir / "missing.bin"));
+    BOOST_CHECK(!komb::MappedFile::open(
+        temp_dir / "missing.bin", komb::FileAccess::kSequential, &error));
+    BOOST_CHECK(error.find("missing.bin") != std::string::npos);
+    error.clear();
+    BOOST_CHECK(!komb::MappedFile::open(temp_dir, komb::FileAccess::kSequential, &error));
+    BOOST_CHECK(!error.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
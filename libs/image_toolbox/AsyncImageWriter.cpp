@@ -0,0 +1,178 @@
+#include "AsyncImageWriter.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#include <boost/filesystem.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <common/Logging.hpp>
+#include <common/Profiler.hpp>
+#include <common/Throw.hpp>
+
+#include "ImageIo.hpp"
+
+namespace komb {
+
+AsyncImageWriter::AsyncImageWriter(size_t num_threads, size_t max_queued)
+    : max_queued_(max_queued)
+{
+    CHECK_GT(num_threads, 0u);
+    CHECK_GT(max_queued, 0u);
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        workers_.emplace_back(&AsyncImageWriter::workerLoop, this);
+    }
+}
+
+AsyncImageWriter::~AsyncImageWriter()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        job_done_.wait(lock, [this]() { return queue_.empty() && num_in_progress_ == 0; });
+        for (const auto& error : errors_)
+        {
+            LOG(ERROR) << error;
+        }
+        stop_ = true;
+    }
+    job_added_.notify_all();
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void AsyncImageWriter::write(const fs::path& path, cv::Mat image, const std::vector<int>& params)
+{
+    writeWith(path, std::move(image), [params](const fs::path& out_path, const cv::Mat& pixels)
+    {
+        return cv::imwrite(out_path.string(), pixels, params);
+    });
+}
+
+void AsyncImageWriter::writeWith(const fs::path& path, cv::Mat image, WriteFunction write_image)
+{
+    // Pixels that the caller, or a view of them, still refers to could be overwritten before
+    // the image is encoded, e.g. by reusing an output buffer for the next frame.
+    if (image.u == nullptr || image.u->refcount > 1)
+    {
+        image = image.clone();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_done_.wait(lock, [this]() { return queue_.size() < max_queued_; });
+    queue_.push_back(Job{path, std::move(image), std::move(write_image)});
+    lock.unlock();
+    job_added_.notify_one();
+}
+
+void AsyncImageWriter::writeColor(const fs::path& path, cv::Mat image)
+{
+    writeWith(path, std::move(image), tryWriteColorCvImage);
+}
+
+void AsyncImageWriter::writeDepth(const fs::path& path, cv::Mat1f depth)
+{
+    writeWith(path, std::move(depth), [](const fs::path& out_path, const cv::Mat& pixels)
+    {
+        return tryWriteDepthCvImage(out_path, pixels);
+    });
+}
+
+void AsyncImageWriter::writeGray(const fs::path& path, cv::Mat image)
+{
+    writeWith(path, std::move(image), tryWriteGrayCvImage);
+}
+
+void AsyncImageWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_done_.wait(lock, [this]() { return queue_.empty() && num_in_progress_ == 0; });
+    if (!errors_.empty())
+    {
+        std::string message = "Failed to write " + std::to_string(errors_.size()) + " images:";
+        for (const auto& error : errors_)
+        {
+            message += "\n" + error;
+        }
+        errors_.clear();
+        LOG_THROW std::runtime_error(message);
+    }
+}
+
+size_t AsyncImageWriter::numWritten() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_written_;
+}
+
+void AsyncImageWriter::createParentDirectory(const fs::path& path)
+{
+    const fs::path directory = path.parent_path();
+    if (directory.empty())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (existing_directories_.count(directory.string()) != 0)
+        {
+            return;
+        }
+    }
+    // Throws on failure. Two threads may both get here, which is harmless.
+    fs::create_directories(directory);
+    std::lock_guard<std::mutex> lock(mutex_);
+    existing_directories_.insert(directory.string());
+}
+
+void AsyncImageWriter::workerLoop()
+{
+    setThreadName("image writer");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+        job_added_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+        if (queue_.empty())
+        {
+            return;
+        }
+
+        Job job = std::move(queue_.front());
+        queue_.pop_front();
+        num_in_progress_ += 1;
+        lock.unlock();
+        job_done_.notify_all(); // There is room for another job in the queue.
+
+        std::string error;
+        try
+        {
+            PROFILE_STAGE(writeImage);
+            createParentDirectory(job.path);
+            if (!job.write_image(job.path, job.image))
+            {
+                error = "Could not save image to: " + job.path.string();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            error = "Could not save image to: " + job.path.string() + ": " + e.what();
+        }
+
+        lock.lock();
+        num_in_progress_ -= 1;
+        if (error.empty())
+        {
+            num_written_ += 1;
+        }
+        else
+        {
+            errors_.push_back(error);
+        }
+        job_done_.notify_all();
+    }
+}
+
+} // namespace komb
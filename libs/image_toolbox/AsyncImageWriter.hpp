@@ -0,0 +1,90 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include <common/Path.hpp>
+
+namespace komb {
+
+/**
+ * @brief Encodes and writes images on a pool of background threads.
+ *
+ * write() only queues the image, so the caller does not wait for the compression.
+ * writeColor(), writeDepth() and writeGray() encode like writeColorCvImage, writeDepthCvImage
+ * and writeGrayCvImage, so their files are the same as when written on the calling thread.
+ * Parent directories are created as needed, and remembered so that each is only checked once.
+ * Errors are collected and thrown from the next flush().
+ */
+class AsyncImageWriter
+{
+public:
+    /// write() blocks while max_queued images are waiting for an encoder thread.
+    explicit AsyncImageWriter(size_t num_threads = 2, size_t max_queued = 8);
+
+    /// Waits for all queued images. Errors are logged, call flush() first to handle them.
+    ~AsyncImageWriter();
+
+    AsyncImageWriter(const AsyncImageWriter&) = delete;
+    AsyncImageWriter& operator=(const AsyncImageWriter&) = delete;
+
+    /// Writes path from image and returns false on failure. Called from the writer threads.
+    using WriteFunction = std::function<bool(const fs::path& path, const cv::Mat& image)>;
+
+    /// Queue an image for writing. params is the same as for cv::imwrite.
+    /// The pixels are copied if anyone else refers to them, so pass the image with std::move
+    /// to hand it over without a copy.
+    void write(const fs::path& path, cv::Mat image, const std::vector<int>& params = {});
+
+    /// Queue an image to be written by write_image, e.g. tryWriteColorCvImage.
+    /// The pixels are copied like for write().
+    void writeWith(const fs::path& path, cv::Mat image, WriteFunction write_image);
+
+    /// Like writeColorCvImage.
+    void writeColor(const fs::path& path, cv::Mat image);
+    /// Like writeDepthCvImage.
+    void writeDepth(const fs::path& path, cv::Mat1f depth);
+    /// Like writeGrayCvImage.
+    void writeGray(const fs::path& path, cv::Mat image);
+
+    /// Block until all queued images are written.
+    /// Throws std::runtime_error naming the images that failed since the last flush().
+    void flush();
+
+    /// Number of images written successfully so far.
+    size_t numWritten() const;
+
+private:
+    struct Job
+    {
+        fs::path      path;
+        cv::Mat       image;
+        WriteFunction write_image;
+    };
+
+    void workerLoop();
+    void createParentDirectory(const fs::path& path);
+
+    const size_t max_queued_;
+
+    mutable std::mutex              mutex_;
+    std::condition_variable         job_added_;
+    std::condition_variable         job_done_;
+    std::deque<Job>                 queue_;
+    size_t                          num_in_progress_ = 0;
+    size_t                          num_written_ = 0;
+    std::vector<std::string>        errors_;
+    bool                            stop_ = false;
+    std::unordered_set<std::string> existing_directories_;
+    std::vector<std::thread>        workers_;
+};
+
+} // namespace komb
@@ -0,0 +1,99 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <stdexcept>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <opencv2/core.hpp>
+
+#include <common/ScopeExit.hpp>
+#include <file_io_toolbox/FileIo.hpp>
+#include <image_toolbox/AsyncImageWriter.hpp>
+#include <image_toolbox/ImageIo.hpp>
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(image_toolbox)
+
+BOOST_AUTO_TEST_CASE(AsyncImageWriterWritesAllImages)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("writer_%%%%%%%%");
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    const int kNumImages = 20;
+    komb::AsyncImageWriter writer(3, 2);
+    for (int i = 0; i < kNumImages; ++i)
+    {
+        const fs::path path = temp_dir / std::to_string(i % 4) / (std::to_string(i) + ".png");
+        writer.write(path, cv::Mat1b(4, 4, static_cast<uint8_t>(i)));
+    }
+    writer.flush();
+    BOOST_CHECK_EQUAL(writer.numWritten(), static_cast<size_t>(kNumImages));
+
+    for (int i = 0; i < kNumImages; ++i)
+    {
+        const fs::path path = temp_dir / std::to_string(i % 4) / (std::to_string(i) + ".png");
+        const cv::Mat image = komb::readCvImage(path, cv::IMREAD_GRAYSCALE);
+        BOOST_REQUIRE(!image.empty());
+        BOOST_CHECK_EQUAL(static_cast<int>(image.at<uint8_t>(0, 0)), i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AsyncImageWriterMatchesImageIo)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("writer_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    cv::Mat3b color(24, 32);
+    cv::randu(color, 0, 256);
+    cv::Mat1f depth(24, 32);
+    cv::randu(depth, 0.2f, 3.0f);
+    cv::Mat1f gray(24, 32);
+    cv::randu(gray, 0.0f, 1.0f);
+
+    komb::writeColorCvImage(temp_dir / "sync_color.jpg", color);
+    komb::writeDepthCvImage(temp_dir / "sync_depth.png", depth);
+    komb::writeGrayCvImage(temp_dir / "sync_gray.png", gray);
+
+    komb::AsyncImageWriter writer;
+    writer.writeColor(temp_dir / "async_color.jpg", color);
+    writer.writeDepth(temp_dir / "async_depth.png", depth);
+    writer.writeGray(temp_dir / "async_gray.png", gray);
+
+    // The writer has its own copy of the pixels, so the caller may reuse its buffers.
+    color.setTo(cv::Vec3b(0, 0, 0));
+    depth.setTo(0.0f);
+    gray.setTo(0.0f);
+    writer.flush();
+
+    for (const std::string name : {"color.jpg", "depth.png", "gray.png"})
+    {
+        const auto sync_bytes = komb::readBinaryFile(temp_dir / ("sync_" + name));
+        const auto async_bytes = komb::readBinaryFile(temp_dir / ("async_" + name));
+        BOOST_REQUIRE(sync_bytes && async_bytes);
+        BOOST_CHECK_MESSAGE(*sync_bytes == *async_bytes, name);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AsyncImageWriterThrowsOnFlush)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("writer_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    // A file where the writer needs a directory.
+    komb::writeTextFile(temp_dir / "not_a_directory", "");
+
+    komb::AsyncImageWriter writer;
+    writer.write(temp_dir / "ok.png", cv::Mat1b(4, 4, uint8_t(0)));
+    writer.write(temp_dir / "not_a_directory" / "fail.png", cv::Mat1b(4, 4, uint8_t(0)));
+    BOOST_CHECK_THROW(writer.flush(), std::runtime_error);
+    BOOST_CHECK_EQUAL(writer.numWritten(), 1u);
+
+    // Errors are only reported once.
+    writer.flush();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
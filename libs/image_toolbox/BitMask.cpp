@@ -0,0 +1,284 @@
+#include "BitMask.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <common/Logging.hpp>
+
+#include "Convert.hpp"
+
+namespace komb {
+
+namespace {
+
+const uint64_t kAllBits = ~uint64_t(0);
+
+size_t wordsForWidth(size_t width)
+{
+    return (width + 63) / 64;
+}
+
+void checkSameSize(const BitMask& a, const BitMask& b)
+{
+    CHECK_EQ_F(a.width(), b.width());
+    CHECK_EQ_F(a.height(), b.height());
+}
+
+/// Pack one row of bytes into words, a bit is set for bytes above threshold.
+void packRow(const uint8_t* pixels, size_t width, uint8_t threshold, uint64_t* out_words)
+{
+    size_t x = 0;
+#ifdef __SSE2__
+    if (threshold < 255)
+    {
+        // SSE2 only compares signed bytes, so use: p > threshold <=> max(p, threshold + 1) == p.
+        const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold + 1));
+        for (; x + 64 <= width; x += 64)
+        {
+            uint64_t word = 0;
+            for (size_t i = 0; i < 64; i += 16)
+            {
+                const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + x + i));
+                const __m128i above = _mm_cmpeq_epi8(_mm_max_epu8(p, limit), p);
+                word |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(above))) << i;
+            }
+            out_words[x / 64] = word;
+        }
+    }
+#endif
+    for (; x < width; x += 64)
+    {
+        const size_t n = std::min<size_t>(64, width - x);
+        uint64_t word = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            word |= uint64_t(pixels[x + i] > threshold) << i;
+        }
+        out_words[x / 64] = word;
+    }
+}
+
+/// Expand one row of words into bytes, 255 for set bits and 0 otherwise.
+void unpackRow(const uint64_t* words, size_t width, uint8_t* out_pixels)
+{
+    size_t x = 0;
+#ifdef __SSE2__
+    // Broadcast each byte of bits to 8 lanes, and keep a different bit in each lane.
+    const __m128i bit_select = _mm_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const uint64_t kBroadcast = 0x0101010101010101;
+    for (; x + 16 <= width; x += 16)
+    {
+        const uint64_t bits = words[x / 64] >> (x % 64);
+        const __m128i spread = _mm_set_epi64x(
+            static_cast<int64_t>(((bits >> 8) & 0xFF) * kBroadcast),
+            static_cast<int64_t>((bits & 0xFF) * kBroadcast));
+        const __m128i set = _mm_cmpeq_epi8(_mm_and_si128(spread, bit_select), bit_select);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out_pixels + x), set);
+    }
+#endif
+    for (; x < width; ++x)
+    {
+        out_pixels[x] = ((words[x / 64] >> (x % 64)) & 1u) ? 255 : 0;
+    }
+}
+
+} // namespace
+
+BitMask::BitMask(size_t width, size_t height, bool value)
+    : width_(width)
+    , height_(height)
+    , words_per_row_(wordsForWidth(width))
+    , words_(words_per_row_ * height, value ? kAllBits : 0)
+{
+    clearPadding();
+}
+
+size_t BitMask::count() const
+{
+    size_t result = 0;
+    for (uint64_t word : words_)
+    {
+        result += std::bitset<64>(word).count();
+    }
+    return result;
+}
+
+BitMask& BitMask::operator&=(const BitMask& other)
+{
+    checkSameSize(*this, other);
+    for (size_t i = 0; i < words_.size(); ++i)
+    {
+        words_[i] &= other.words_[i];
+    }
+    return *this;
+}
+
+BitMask& BitMask::operator|=(const BitMask& other)
+{
+    checkSameSize(*this, other);
+    for (size_t i = 0; i < words_.size(); ++i)
+    {
+        words_[i] |= other.words_[i];
+    }
+    return *this;
+}
+
+BitMask& BitMask::operator^=(const BitMask& other)
+{
+    checkSameSize(*this, other);
+    for (size_t i = 0; i < words_.size(); ++i)
+    {
+        words_[i] ^= other.words_[i];
+    }
+    return *this;
+}
+
+void BitMask::flip()
+{
+    for (uint64_t& word : words_)
+    {
+        word = ~word;
+    }
+    clearPadding();
+}
+
+bool BitMask::operator==(const BitMask& other) const
+{
+    return width_ == other.width_ && height_ == other.height_ && words_ == other.words_;
+}
+
+void BitMask::clearPadding()
+{
+    if (width_ % 64 == 0)
+    {
+        return;
+    }
+    const uint64_t last_word_bits = (uint64_t(1) << (width_ % 64)) - 1;
+    for (size_t y = 0; y < height_; ++y)
+    {
+        row(y)[words_per_row_ - 1] &= last_word_bits;
+    }
+}
+
+BitMask operator&(BitMask a, const BitMask& b)
+{
+    a &= b;
+    return a;
+}
+
+BitMask operator|(BitMask a, const BitMask& b)
+{
+    a |= b;
+    return a;
+}
+
+BitMask operator^(BitMask a, const BitMask& b)
+{
+    a ^= b;
+    return a;
+}
+
+BitMask operator~(BitMask mask)
+{
+    mask.flip();
+    return mask;
+}
+
+BitMask bitMaskFromCv(const cv::Mat1b& cv_mask, uint8_t threshold)
+{
+    BitMask mask(static_cast<size_t>(cv_mask.cols), static_cast<size_t>(cv_mask.rows));
+    for (int y = 0; y < cv_mask.rows; ++y)
+    {
+        packRow(cv_mask[y], mask.width(), threshold, mask.row(static_cast<size_t>(y)));
+    }
+    return mask;
+}
+
+BitMask bitMaskFromBgr(const cv::Mat3b& bgr, float intensity_threshold)
+{
+    // rgbIntensity(rgb / 255) > t  <=>  30 r + 59 g + 11 b > 25500 t, exact in integers.
+    // The weighted sum is an integer, so the limit can be rounded down.
+    const float limit_float = std::floor(intensity_threshold * 25500.0f);
+    const int limit = static_cast<int>(std::max(-1.0f, std::min(limit_float, 25500.0f)));
+
+    BitMask mask(static_cast<size_t>(bgr.cols), static_cast<size_t>(bgr.rows));
+    const size_t width = mask.width();
+    for (int y = 0; y < bgr.rows; ++y)
+    {
+        const cv::Vec3b* pixels = bgr[y];
+        uint64_t* words = mask.row(static_cast<size_t>(y));
+        for (size_t x = 0; x < width; x += 64)
+        {
+            const size_t n = std::min<size_t>(64, width - x);
+            uint64_t word = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                const cv::Vec3b& p = pixels[x + i];
+                const int weighted = 11 * p[0] + 59 * p[1] + 30 * p[2];
+                word |= uint64_t(weighted > limit) << i;
+            }
+            words[x / 64] = word;
+        }
+    }
+    return mask;
+}
+
+BitMask bitMaskFromCvMat(const cv::Mat& cv_image)
+{
+    CHECK_EQ_F(cv_image.depth(), CV_8U);
+    switch (cv_image.channels())
+    {
+    case 1: return bitMaskFromCv(cv_image);
+    case 3: return bitMaskFromBgr(cv_image);
+    case 4: return bitMaskFromBgr(ignoreAlpha(cv_image));
+    default: ABORT_F("Expected 1, 3 or 4 channels, got %d", cv_image.channels());
+    }
+}
+
+cv::Mat1b cvMaskFromBitMask(const BitMask& mask)
+{
+    cv::Mat1b cv_mask(static_cast<int>(mask.height()), static_cast<int>(mask.width()));
+    for (int y = 0; y < cv_mask.rows; ++y)
+    {
+        unpackRow(mask.row(static_cast<size_t>(y)), mask.width(), cv_mask[y]);
+    }
+    return cv_mask;
+}
+
+BitMask bitMaskFromImage(const Imageb& image_mask)
+{
+    BitMask mask(image_mask.width(), image_mask.height());
+    for (size_t y = 0; y < mask.height(); ++y)
+    {
+        const bool* pixels = image_mask.data() + y * mask.width();
+        uint64_t* words = mask.row(y);
+        for (size_t x = 0; x < mask.width(); ++x)
+        {
+            words[x / 64] |= uint64_t(pixels[x]) << (x % 64);
+        }
+    }
+    return mask;
+}
+
+Imageb imageMaskFromBitMask(const BitMask& mask)
+{
+    Imageb image_mask(mask.width(), mask.height());
+    for (size_t y = 0; y < mask.height(); ++y)
+    {
+        const uint64_t* words = mask.row(y);
+        bool* pixels = image_mask.data() + y * mask.width();
+        for (size_t x = 0; x < mask.width(); ++x)
+        {
+            pixels[x] = (words[x / 64] >> (x % 64)) & 1u;
+        }
+    }
+    return image_mask;
+}
+
+} // namespace komb
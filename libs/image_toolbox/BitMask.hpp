@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "Image.hpp"
+
+namespace komb {
+
+/**
+ * @brief Binary image with 64 pixels per word, an eighth of the memory of Imageb.
+ *
+ * Pixel x of a row is bit x % 64 of word x / 64. Each row starts on a new word and the padding
+ * bits at the end of a row are always zero, so counting and boolean operations work on whole
+ * words.
+ */
+class BitMask
+{
+public:
+    BitMask() = default;
+    BitMask(size_t width, size_t height, bool value = false);
+
+    size_t width()       const { return width_; }
+    size_t height()      const { return height_; }
+    size_t wordsPerRow() const { return words_per_row_; }
+    bool   empty()       const { return words_.empty(); }
+
+    bool operator()(size_t x, size_t y) const
+    {
+        return (row(y)[x / 64] >> (x % 64)) & 1u;
+    }
+
+    void set(size_t x, size_t y, bool value)
+    {
+        const uint64_t bit = uint64_t(1) << (x % 64);
+        uint64_t& word = row(y)[x / 64];
+        word = value ? (word | bit) : (word & ~bit);
+    }
+
+    uint64_t*       row(size_t y)       { return words_.data() + y * words_per_row_; }
+    const uint64_t* row(size_t y) const { return words_.data() + y * words_per_row_; }
+
+    /// Number of set pixels.
+    size_t count() const;
+
+    BitMask& operator&=(const BitMask& other);
+    BitMask& operator|=(const BitMask& other);
+    BitMask& operator^=(const BitMask& other);
+
+    /// Invert every pixel.
+    void flip();
+
+    bool operator==(const BitMask& other) const;
+    bool operator!=(const BitMask& other) const { return !(*this == other); }
+
+private:
+    void clearPadding();
+
+    size_t                width_ = 0;
+    size_t                height_ = 0;
+    size_t                words_per_row_ = 0;
+    std::vector<uint64_t> words_;
+};
+
+BitMask operator&(BitMask a, const BitMask& b);
+BitMask operator|(BitMask a, const BitMask& b);
+BitMask operator^(BitMask a, const BitMask& b);
+BitMask operator~(BitMask mask);
+
+/// Pixels above threshold are set. Same as imageMaskFromCv for the default threshold.
+BitMask bitMaskFromCv(const cv::Mat1b& cv_mask, uint8_t threshold = 127);
+
+/// Pixels with rgbIntensity above intensity_threshold are set.
+BitMask bitMaskFromBgr(const cv::Mat3b& bgr, float intensity_threshold = 0.5f);
+
+/// Like maskFromCvMat: gray images use bitMaskFromCv, color images bitMaskFromBgr.
+/// The alpha channel is ignored.
+BitMask bitMaskFromCvMat(const cv::Mat& cv_image);
+
+/// Set pixels become 255 and the rest 0.
+cv::Mat1b cvMaskFromBitMask(const BitMask& mask);
+
+BitMask bitMaskFromImage(const Imageb& image_mask);
+Imageb imageMaskFromBitMask(const BitMask& mask);
+
+} // namespace komb
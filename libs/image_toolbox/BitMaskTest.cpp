@@ -0,0 +1,106 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <algorithm>
+
+#include <boost/test/unit_test.hpp>
+#include <opencv2/core.hpp>
+
+#include <image_toolbox/BitMask.hpp>
+#include <image_toolbox/OpenCvTools.hpp>
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(image_toolbox)
+
+namespace {
+
+/// Width not a multiple of 64 or 16, to cover the SIMD tails and the row padding.
+cv::Mat1b randomGrayImage()
+{
+    cv::Mat1b image(7, 150);
+    cv::randu(image, 0, 256);
+    return image;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(BitMaskMatchesImageMask)
+{
+    const cv::Mat1b cv_mask = randomGrayImage();
+    const komb::BitMask mask = komb::bitMaskFromCv(cv_mask);
+    const komb::Imageb image_mask = komb::imageMaskFromCv(cv_mask);
+    BOOST_REQUIRE_EQUAL(mask.width(), image_mask.width());
+    BOOST_REQUIRE_EQUAL(mask.height(), image_mask.height());
+
+    size_t num_set = 0;
+    for (size_t y = 0; y < mask.height(); ++y)
+    {
+        for (size_t x = 0; x < mask.width(); ++x)
+        {
+            BOOST_REQUIRE_EQUAL(mask(x, y), image_mask(x, y));
+            num_set += image_mask(x, y) ? 1 : 0;
+        }
+    }
+    BOOST_CHECK_EQUAL(mask.count(), num_set);
+    BOOST_CHECK(mask == komb::bitMaskFromImage(image_mask));
+    BOOST_CHECK_EQUAL(cv::norm(komb::cvMaskFromBitMask(mask), komb::cvMaskFromImage(image_mask),
+        cv::NORM_INF), 0.0);
+
+    const komb::Imageb round_trip = komb::imageMaskFromBitMask(mask);
+    BOOST_CHECK(std::equal(round_trip.begin(), round_trip.end(), image_mask.begin()));
+
+    BOOST_CHECK_EQUAL(komb::bitMaskFromCv(cv_mask, 255).count(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(BitMaskBooleanOperations)
+{
+    const cv::Mat1b cv_a = randomGrayImage();
+    const cv::Mat1b cv_b = randomGrayImage();
+    const komb::BitMask a = komb::bitMaskFromCv(cv_a);
+    const komb::BitMask b = komb::bitMaskFromCv(cv_b);
+    const cv::Mat1b bytes_a = komb::cvMaskFromBitMask(a);
+    const cv::Mat1b bytes_b = komb::cvMaskFromBitMask(b);
+
+    cv::Mat1b expected;
+    cv::bitwise_and(bytes_a, bytes_b, expected);
+    BOOST_CHECK((a & b) == komb::bitMaskFromCv(expected));
+    cv::bitwise_or(bytes_a, bytes_b, expected);
+    BOOST_CHECK((a | b) == komb::bitMaskFromCv(expected));
+    cv::bitwise_xor(bytes_a, bytes_b, expected);
+    BOOST_CHECK((a ^ b) == komb::bitMaskFromCv(expected));
+    cv::bitwise_not(bytes_a, expected);
+    BOOST_CHECK(~a == komb::bitMaskFromCv(expected));
+
+    // Padding bits must stay cleared.
+    BOOST_CHECK_EQUAL((~komb::BitMask(150, 7)).count(), 150u * 7u);
+    BOOST_CHECK_EQUAL(komb::BitMask(150, 7, true).count(), 150u * 7u);
+}
+
+BOOST_AUTO_TEST_CASE(BitMaskFromBgr)
+{
+    cv::Mat3b image(5, 100);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+    image(0, 0) = cv::Vec3b(0, 0, 0);
+    image(0, 1) = cv::Vec3b(255, 255, 255);
+    const komb::BitMask mask = komb::bitMaskFromBgr(image);
+    const komb::Imageb image_mask = komb::maskFromCvMat(image);
+    for (int y = 0; y < image.rows; ++y)
+    {
+        for (int x = 0; x < image.cols; ++x)
+        {
+            const cv::Vec3b& bgr = image(y, x);
+            const int weighted = 11 * bgr[0] + 59 * bgr[1] + 30 * bgr[2];
+            const auto ux = static_cast<size_t>(x);
+            const auto uy = static_cast<size_t>(y);
+            BOOST_REQUIRE_EQUAL(mask(ux, uy), weighted > 12750);
+            if (weighted != 12750) // Float rounding may go either way exactly at the threshold.
+            {
+                BOOST_REQUIRE_EQUAL(mask(ux, uy), image_mask(ux, uy));
+            }
+        }
+    }
+    BOOST_CHECK(!mask(0, 0));
+    BOOST_CHECK(mask(1, 0));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
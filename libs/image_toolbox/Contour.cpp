@@ -1,7 +1,8 @@
 #include "Contour.hpp"
 
 #include <algorithm>
-#include <set>
+#include <cstdint>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -12,6 +13,8 @@
 #include <common/Logging.hpp>
 #include <geometry_toolbox/MetricOpenCv.hpp>
 
+#include "ContourRefinement.hpp"
+#include "LazyGradientField.hpp"
 #include "Magnitude.hpp"
 #include "Tests.hpp"
 
@@ -95,7 +98,15 @@ cv::Point2f refineMaximaSubpix(
 
 Contours2f refineContoursSubpix(const cv::Mat1b& gray, const Contours& contours, int kernel_size)
 {
-    return refineContoursSubpix(makeSubpixelRefiner(gray, kernel_size), contours);
+    // Only compute gradients for the tiles that the contours touch.
+    Contours2f refined_contours(contours.size());
+    for (auto i : indices(contours))
+    {
+        refined_contours[i].resize(contours[i].size());
+        cast(contours[i], refined_contours[i]);
+    }
+    refineContoursSubpixBatched(refined_contours, LazyGradientField(gray, kernel_size));
+    return refined_contours;
 }
 
 Contours2f refineContoursSubpix(const SubpixelRefiner& refiner, const Contours& contours)
@@ -110,46 +121,14 @@ Contours2f refineContoursSubpix(const SubpixelRefiner& refiner, const Contours&
         refined_contours[i].resize(contours[i].size());
         cast(contours[i], refined_contours[i]);
     }
-    for (auto& contour : refined_contours)
-    {
-        refineContourSubpix(contour, refiner);
-    }
+    refineContoursSubpixBatched(refined_contours, DenseGradientField(refiner));
     return refined_contours;
 }
 
 void refineContourSubpix(Contour2f& io_contour, const SubpixelRefiner& refiner)
 {
-    if (io_contour.empty())
-    {
-        return;
-    }
-
     // Refine by finding the local maxima of gradient magnitude in the gradient direction.
-    for (auto& p : io_contour)
-    {
-        if (isInsideImage(p, refiner.dx))
-        {
-            cv::Point2f gradient(refiner.dx(p), refiner.dy(p));
-            p = refineMaximaSubpix(refiner.gradient_magnitude, gradient, p);
-        }
-    }
-
-    // Remove points that are too close together.
-    Contour2f decimated;
-    cv::Point2f prev_point = io_contour.back();
-    for (auto& p : io_contour)
-    {
-        if (distance(p, prev_point) > 0.25f)
-        {
-            decimated.push_back(p);
-            prev_point = p;
-        }
-    }
-
-    if (decimated.size() >= 3)
-    {
-        io_contour = std::move(decimated);
-    }
+    refineContourSubpixBatched(io_contour, DenseGradientField(refiner));
 }
 
 std::vector<float> contourCurvature(const Contour2f& contour)
@@ -212,6 +191,63 @@ double contourCrossGradient(const cv::Mat1f& dx, const cv::Mat1f& dy, const Cont
     }
 }
 
+namespace {
+
+/// A rounded point as one integer, ordered by (y, x) like PointPositionComparator.
+uint64_t packedPointKey(const cv::Point& point)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(point.y) ^ 0x80000000u) << 32) |
+        static_cast<uint64_t>(static_cast<uint32_t>(point.x) ^ 0x80000000u);
+}
+
+/// Append the sorted, unique keys of the contour points rounded to integer pixels.
+void appendSortedPointKeys(const Contour2f& contour, std::vector<uint64_t>& io_keys)
+{
+    const size_t begin = io_keys.size();
+    for (const auto& point : contour)
+    {
+        io_keys.push_back(packedPointKey(cv::Point(point)));
+    }
+    std::sort(io_keys.begin() + begin, io_keys.end());
+    io_keys.erase(std::unique(io_keys.begin() + begin, io_keys.end()), io_keys.end());
+}
+
+size_t numCommonKeys(
+    const uint64_t* a, const uint64_t* a_end, const uint64_t* b, const uint64_t* b_end)
+{
+    size_t num_common = 0;
+    while (a != a_end && b != b_end)
+    {
+        if (*a < *b)
+        {
+            ++a;
+        }
+        else if (*b < *a)
+        {
+            ++b;
+        }
+        else
+        {
+            ++num_common;
+            ++a;
+            ++b;
+        }
+    }
+    return num_common;
+}
+
+double overlapFraction(size_t num_common, size_t size_a, size_t size_b)
+{
+    return double(num_common) * 2.0 / double(size_a + size_b);
+}
+
+struct PointBounds
+{
+    int min_x, min_y, max_x, max_y;
+};
+
+} // namespace
+
 double contourOverlapFraction(const Contour2f& contour_a, const Contour2f& contour_b)
 {
     if (contour_a.empty() || contour_b.empty())
@@ -219,16 +255,92 @@ double contourOverlapFraction(const Contour2f& contour_a, const Contour2f& conto
         return 0.0;
     }
 
-    std::set<cv::Point, PointPositionComparator> set_a;
-    std::set<cv::Point, PointPositionComparator> set_b;
+    // Reused between calls, so this does not allocate once the buffers are large enough.
+    thread_local std::vector<uint64_t> keys_a;
+    thread_local std::vector<uint64_t> keys_b;
+    keys_a.clear();
+    keys_b.clear();
+    appendSortedPointKeys(contour_a, keys_a);
+    appendSortedPointKeys(contour_b, keys_b);
+
+    const size_t num_common = numCommonKeys(
+        keys_a.data(), keys_a.data() + keys_a.size(), keys_b.data(), keys_b.data() + keys_b.size());
+    return overlapFraction(num_common, keys_a.size(), keys_b.size());
+}
 
-    set_a.insert(contour_a.begin(), contour_a.end());
-    set_b.insert(contour_b.begin(), contour_b.end());
+std::vector<ContourOverlap> findOverlappingContours(
+    const Contours2f& contours, double min_fraction)
+{
+    // Keys of contour i are keys[key_offsets[i]] to keys[key_offsets[i + 1]].
+    std::vector<uint64_t> keys;
+    std::vector<size_t> key_offsets(1, 0);
+    std::vector<PointBounds> bounds(contours.size());
+    std::vector<size_t> order;
+    for (auto i : indices(contours))
+    {
+        appendSortedPointKeys(contours[i], keys);
+        key_offsets.push_back(keys.size());
+        if (contours[i].empty())
+        {
+            continue;
+        }
+
+        const cv::Point first(contours[i][0]);
+        bounds[i] = {first.x, first.y, first.x, first.y};
+        for (const auto& point : contours[i])
+        {
+            const cv::Point rounded(point);
+            bounds[i].min_x = std::min(bounds[i].min_x, rounded.x);
+            bounds[i].min_y = std::min(bounds[i].min_y, rounded.y);
+            bounds[i].max_x = std::max(bounds[i].max_x, rounded.x);
+            bounds[i].max_y = std::max(bounds[i].max_y, rounded.y);
+        }
+        order.push_back(i);
+    }
+
+    // Sweep over the contours from left to right, only comparing those that overlap in x.
+    sort(order, [&](size_t lhs, size_t rhs)
+    {
+        return bounds[lhs].min_x < bounds[rhs].min_x;
+    });
+
+    std::vector<ContourOverlap> overlaps;
+    for (auto sweep_a : indices(order))
+    {
+        const size_t a = order[sweep_a];
+        const size_t size_a = key_offsets[a + 1] - key_offsets[a];
+        for (size_t sweep_b = sweep_a + 1;
+            sweep_b < order.size() && bounds[order[sweep_b]].min_x <= bounds[a].max_x; ++sweep_b)
+        {
+            const size_t b = order[sweep_b];
+            if (bounds[b].max_y < bounds[a].min_y || bounds[a].max_y < bounds[b].min_y)
+            {
+                continue;
+            }
+
+            // Skip pairs whose sizes are too different to reach min_fraction.
+            const size_t size_b = key_offsets[b + 1] - key_offsets[b];
+            if (overlapFraction(std::min(size_a, size_b), size_a, size_b) < min_fraction)
+            {
+                continue;
+            }
+
+            const size_t num_common = numCommonKeys(
+                keys.data() + key_offsets[a], keys.data() + key_offsets[a + 1],
+                keys.data() + key_offsets[b], keys.data() + key_offsets[b + 1]);
+            const double fraction = overlapFraction(num_common, size_a, size_b);
+            if (num_common > 0 && fraction >= min_fraction)
+            {
+                overlaps.push_back({std::min(a, b), std::max(a, b), fraction});
+            }
+        }
+    }
 
-    std::vector<cv::Point> intersection;
-    std::set_intersection(set_a.begin(), set_a.end(), set_b.begin(), set_b.end(),
-        std::back_inserter(intersection), PointPositionComparator());
-    return double(intersection.size()) * 2.0 / (set_a.size() + set_b.size());
+    sort(overlaps, [](const ContourOverlap& lhs, const ContourOverlap& rhs)
+    {
+        return std::tie(lhs.index_a, lhs.index_b) < std::tie(rhs.index_a, rhs.index_b);
+    });
+    return overlaps;
 }
 
 // ----------------------------------------------------------------------------
@@ -290,77 +402,129 @@ Contours2f splitContourByDiagonality(const Contour2f& contour, float angle_thres
 
 // ----------------------------------------------------------------------------
 
-cv::Point2f segmentDir(const Contour2f& segment)
+namespace {
+
+cv::Point2f segmentDir(const Contour2f& contour, const ContourSegment& segment)
 {
     CHECK_GE(segment.size(), 2u);
-    return normalized(segment.back() - segment.front());
+    const size_t n = contour.size();
+    return normalized(contour[(segment.end - 1) % n] - contour[segment.begin % n]);
 }
 
-// Would appending the given point to segment keep the direction of the segment?
-bool followsDirectionality(
-    const Contour2f& segment, const cv::Point2f& new_dir, float dot_threshold)
+// Would appending a segment or point in direction new_dir keep the direction of the segment?
+bool followsDirectionality(const Contour2f& contour, const ContourSegment& segment,
+    const cv::Point2f& new_dir, float dot_threshold)
 {
     if (segment.size() < 2)
     {
-       return true;
+        return true;
     }
 
-    bool same_dir = segmentDir(segment).dot(new_dir) > dot_threshold;
+    bool same_dir = segmentDir(contour, segment).dot(new_dir) > dot_threshold;
     return same_dir;
 }
 
-bool mergeConsecutiveIfSameDirection(Contours2f& io_segments, float dot_threshold)
+bool canMerge(const Contour2f& contour, const ContourSegment& segment_a,
+    const ContourSegment& segment_b, float dot_threshold)
 {
-    bool did_merge = false;
+    return followsDirectionality(
+        contour, segment_b, segmentDir(contour, segment_a), dot_threshold);
+}
 
-    for (size_t i = 0; i < io_segments.size() && io_segments.size() > 1; )
+} // namespace
+
+Contour2f segmentPoints(const Contour2f& contour, const ContourSegment& segment)
+{
+    Contour2f points;
+    points.reserve(segment.size());
+    for (size_t i = segment.begin; i < segment.end; ++i)
     {
-        auto& segment_a = io_segments[i];
-        auto& segment_b  = io_segments[(i + 1) % io_segments.size()];
-        if (followsDirectionality(segment_b, segmentDir(segment_a), dot_threshold))
-        {
-            append(segment_a, segment_b);
-            segment_a.swap(segment_b);
-            eraseIndex(io_segments, i);
-            did_merge = true;
-        }
-        else
-        {
-            ++i;
-        }
+        points.push_back(contour[i % contour.size()]);
     }
-
-    return did_merge;
+    return points;
 }
 
-Contours2f splitContourByDirectionality(const Contour2f& in_contour, float angle_threshold)
+void segmentContourByDirectionality(
+    const Contour2f& contour, float angle_threshold, std::vector<ContourSegment>& out_segments)
 {
-    if (in_contour.empty())
+    out_segments.clear();
+    const size_t n = contour.size();
+    if (n == 0)
     {
-        return {};
+        return;
     }
 
     const float dot_threshold = std::cos(angle_threshold);
 
-    Contours2f out_segments(1, Contour2f{in_contour[0]});
+    // Grow segments greedily. Every finished segment is merged with the segments before it
+    // for as long as they share direction, so out_segments works as a stack.
+    auto push_segment = [&](ContourSegment segment)
+    {
+        while (!out_segments.empty() &&
+            canMerge(contour, out_segments.back(), segment, dot_threshold))
+        {
+            segment.begin = out_segments.back().begin;
+            out_segments.pop_back();
+        }
+        out_segments.push_back(segment);
+    };
 
-    for (const auto i : irange<size_t>(1, in_contour.size()))
+    ContourSegment current{0, 1};
+    for (const auto i : irange<size_t>(1, n))
     {
-        const auto& point = in_contour[i];
-        Contour2f& current_segment = out_segments.back();
-        cv::Point2f new_dir = normalized(point - current_segment.back());
-        if (followsDirectionality(current_segment, new_dir, dot_threshold))
+        const cv::Point2f new_dir = normalized(contour[i] - contour[i - 1]);
+        if (followsDirectionality(contour, current, new_dir, dot_threshold))
         {
-            current_segment.push_back(point);
+            current.end = i + 1;
         }
         else
         {
-            out_segments.push_back({point});
+            push_segment(current);
+            current = ContourSegment{i, i + 1};
         }
     }
+    push_segment(current);
 
-    while (mergeConsecutiveIfSameDirection(out_segments, dot_threshold)) { }
+    // The contour is closed, so merge across its start. The last segment is prepended to the
+    // first, which may then merge with the second one, and so on. Segments in between are
+    // already final.
+    size_t first = 0;
+    while (out_segments.size() - first > 1)
+    {
+        ContourSegment& front = out_segments[first];
+        const ContourSegment& back = out_segments.back();
+        const ContourSegment& second = out_segments[first + 1];
+        const bool front_wraps = front.end > n;
+        if (canMerge(contour, back, front, dot_threshold))
+        {
+            front = ContourSegment{back.begin, front_wraps ? front.end : front.end + n};
+            out_segments.pop_back();
+        }
+        else if (canMerge(contour, front, second, dot_threshold))
+        {
+            out_segments[first + 1] =
+                ContourSegment{front.begin, front_wraps ? second.end + n : second.end};
+            ++first;
+        }
+        else
+        {
+            break;
+        }
+    }
+    out_segments.erase(out_segments.begin(), out_segments.begin() + static_cast<long>(first));
+}
+
+Contours2f splitContourByDirectionality(const Contour2f& in_contour, float angle_threshold)
+{
+    std::vector<ContourSegment> segments;
+    segmentContourByDirectionality(in_contour, angle_threshold, segments);
 
+    Contours2f out_segments;
+    out_segments.reserve(segments.size());
+    for (const auto& segment : segments)
+    {
+        out_segments.push_back(segmentPoints(in_contour, segment));
+    }
     return out_segments;
 }
 
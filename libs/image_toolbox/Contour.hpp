@@ -5,6 +5,8 @@
 
 #include <opencv2/core/mat.hpp>
 
+#include <common/ArenaAllocator.hpp>
+
 namespace komb {
 
 using Contour    = std::vector<cv::Point>;
@@ -12,6 +14,9 @@ using Contour2f  = std::vector<cv::Point2f>;
 using Contours   = std::vector<Contour>;
 using Contours2f = std::vector<Contour2f>;
 
+/// A contour whose points come from a MemoryResource, e.g. the ScratchScope of a detection.
+using ArenaContour2f = ArenaVector<cv::Point2f>;
+
 struct SubpixelRefiner
 {
     cv::Mat1f dx;
@@ -28,6 +33,7 @@ cv::Point2f refineMaximaSubpix(
     const cv::Point2f& gradient,
     const cv::Point2f& point);
 
+/// Computes gradients lazily, only around the contours. See LazyGradientField.
 Contours2f refineContoursSubpix(const cv::Mat1b& gray, const Contours& contours, int kernel_size);
 
 Contours2f refineContoursSubpix(const SubpixelRefiner& refiner, const Contours& contours);
@@ -39,13 +45,44 @@ std::vector<float> contourCurvature(const Contour2f& contour);
 /// Compute the average intensity change orthogonal to the contour segments.
 double contourCrossGradient(const cv::Mat1f& dx, const cv::Mat1f& dy, const Contour2f& contour);
 
-/// Compute the fraction of overlap of contour points.
+/// Compute the fraction of overlap of contour points, rounded to integer pixels.
 double contourOverlapFraction(const Contour2f& contour_a, const Contour2f& contour_b);
 
+struct ContourOverlap
+{
+    size_t index_a; ///< index_a < index_b.
+    size_t index_b;
+    double fraction; ///< contourOverlapFraction of the two contours.
+};
+
+/// Find all pairs of contours that overlap with at least min_fraction and at least one point.
+/// Contours with disjoint bounding boxes are never compared. Sorted by (index_a, index_b).
+std::vector<ContourOverlap> findOverlappingContours(
+    const Contours2f& contours, double min_fraction);
+
+/// A contiguous range of points of a closed contour, without copying the points.
+/// end may exceed the contour size for a segment that wraps around the start of the contour,
+/// so point i of the segment is contour[(begin + i) % contour.size()].
+struct ContourSegment
+{
+    size_t begin;
+    size_t end;
+
+    size_t size() const { return end - begin; }
+};
+
+/// Copy the points of a segment.
+Contour2f segmentPoints(const Contour2f& contour, const ContourSegment& segment);
+
 /// Split contour into contiguous segments where
 /// consecutive line segments are equidirectional within max_directionality_angle radians
 Contours2f splitContourByDirectionality(const Contour2f& in_contour, float angle_threshold);
 
+/// Same as splitContourByDirectionality, but returns views into the contour.
+/// Runs in linear time and reuses the memory of out_segments.
+void segmentContourByDirectionality(
+    const Contour2f& contour, float angle_threshold, std::vector<ContourSegment>& out_segments);
+
 /// Similar to the above but classified direction crudely as one of eight direction on a unit square
 Contours2f splitContourByDiagonality(const Contour2f& contour, float angle_threshold);
 
@@ -0,0 +1,110 @@
+#include "ContourFeatures.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <common/Logging.hpp>
+
+namespace komb {
+
+namespace {
+
+template<bool kAllFeatures>
+ContourFeatures computeFeatures(const ContourSoA& contour,
+    const cv::Mat1f& dx, const cv::Mat1f& dy, float* out_curvature)
+{
+    ContourFeatures features;
+    const size_t n = contour.size();
+    if (n == 0)
+    {
+        return features;
+    }
+
+    // Neighbours of point i are at index i in prev_* and next_*, thanks to the padding.
+    const float* xs = contour.xs();
+    const float* ys = contour.ys();
+    const float* prev_xs = xs - 1;
+    const float* prev_ys = ys - 1;
+    const float* next_xs = xs + 1;
+    const float* next_ys = ys + 1;
+
+    double length = 0.0;
+    double twice_area = 0.0;
+    double cross_sum = 0.0;
+    double cross_weight = 0.0;
+    float min_x = xs[0];
+    float min_y = ys[0];
+    float max_x = xs[0];
+    float max_y = ys[0];
+
+#ifdef _OPENMP
+    #pragma omp simd reduction(+:length, twice_area, cross_sum, cross_weight) \
+        reduction(min:min_x, min_y) reduction(max:max_x, max_y)
+#endif
+    for (size_t i = 0; i < n; ++i)
+    {
+        const float edge_x = next_xs[i] - xs[i];
+        const float edge_y = next_ys[i] - ys[i];
+        length += std::sqrt(edge_x * edge_x + edge_y * edge_y);
+        twice_area += double(xs[i]) * next_ys[i] - double(next_xs[i]) * ys[i];
+        min_x = std::min(min_x, xs[i]);
+        min_y = std::min(min_y, ys[i]);
+        max_x = std::max(max_x, xs[i]);
+        max_y = std::max(max_y, ys[i]);
+
+        if (kAllFeatures)
+        {
+            //       c
+            //      /
+            // a---b
+            const float dp_x = (next_xs[i] - prev_xs[i]) / 2;
+            const float dp_y = (next_ys[i] - prev_ys[i]) / 2;
+            const float ddp_x = next_xs[i] - 2 * xs[i] + prev_xs[i];
+            const float ddp_y = next_ys[i] - 2 * ys[i] + prev_ys[i];
+            const float norm_dp = std::sqrt(dp_x * dp_x + dp_y * dp_y);
+            out_curvature[i] =
+                std::abs(ddp_y * dp_x - ddp_x * dp_y) / (norm_dp * norm_dp * norm_dp);
+
+            const int x = cv::saturate_cast<int>(xs[i]);
+            const int y = cv::saturate_cast<int>(ys[i]);
+            if (x >= 0 && y >= 0 && x < dx.cols && y < dx.rows)
+            {
+                cross_sum += dp_x * dy(y, x) - dp_y * dx(y, x);
+                cross_weight += norm_dp;
+            }
+        }
+    }
+
+    features.length = length;
+    features.signed_area = 0.5 * twice_area;
+    features.cross_gradient = cross_weight > 0 ? cross_sum / cross_weight : 0.0;
+    features.bounding_box = cv::Rect2f(min_x, min_y, max_x - min_x, max_y - min_y);
+    return features;
+}
+
+} // namespace
+
+Contour2f ContourSoA::toContour2f() const
+{
+    Contour2f contour(size_);
+    for (size_t i = 0; i < size_; ++i)
+    {
+        contour[i] = point(i);
+    }
+    return contour;
+}
+
+ContourFeatures contourShapeFeatures(const ContourSoA& contour)
+{
+    return computeFeatures<false>(contour, cv::Mat1f(), cv::Mat1f(), nullptr);
+}
+
+ContourFeatures contourFeatures(const ContourSoA& contour,
+    const cv::Mat1f& dx, const cv::Mat1f& dy, std::vector<float>& out_curvature)
+{
+    CHECK_EQ(dx.size(), dy.size());
+    out_curvature.resize(contour.size());
+    return computeFeatures<true>(contour, dx, dy, out_curvature.data());
+}
+
+} // namespace komb
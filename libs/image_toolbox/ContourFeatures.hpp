@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "Contour.hpp"
+
+namespace komb {
+
+/**
+ * @brief Points of a closed contour as structure-of-arrays.
+ *
+ * The coordinates are padded with the last point before the first one and the first point
+ * after the last one, so xs()[-1] and xs()[size()] are valid. Per-point computations that need
+ * the neighbours of each point can then run in one loop without modular indexing.
+ */
+class ContourSoA
+{
+public:
+    ContourSoA() = default;
+
+    template<typename T>
+    explicit ContourSoA(const std::vector<cv::Point_<T>>& contour) { assign(contour); }
+
+    /// Replace the points, reusing the allocated memory.
+    template<typename T>
+    void assign(const std::vector<cv::Point_<T>>& contour)
+    {
+        size_ = contour.size();
+        xs_.resize(size_ + 2);
+        ys_.resize(size_ + 2);
+        if (size_ == 0)
+        {
+            return;
+        }
+
+        for (size_t i = 0; i < size_; ++i)
+        {
+            xs_[i + 1] = static_cast<float>(contour[i].x);
+            ys_[i + 1] = static_cast<float>(contour[i].y);
+        }
+        xs_[0] = xs_[size_];
+        ys_[0] = ys_[size_];
+        xs_[size_ + 1] = xs_[1];
+        ys_[size_ + 1] = ys_[1];
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const float* xs() const { return xs_.data() + 1; }
+    const float* ys() const { return ys_.data() + 1; }
+
+    cv::Point2f point(size_t i) const { return cv::Point2f(xs()[i], ys()[i]); }
+
+    Contour2f toContour2f() const;
+
+private:
+    std::vector<float> xs_;
+    std::vector<float> ys_;
+    size_t size_ = 0;
+};
+
+struct ContourFeatures
+{
+    double length = 0;         ///< Length of the closed contour.
+    double signed_area = 0;    ///< Same sign as cv::contourArea(contour, true).
+    double cross_gradient = 0; ///< See contourCrossGradient. Only set by contourFeatures.
+    cv::Rect2f bounding_box;   ///< Spans from the smallest to the largest coordinates.
+};
+
+/// Length, area and bounding box in a single pass, without touching any image.
+ContourFeatures contourShapeFeatures(const ContourSoA& contour);
+
+/**
+ * @brief All features in a single pass over the points.
+ *
+ * Equivalent to contourCurvature, contourCrossGradient, cv::arcLength(contour, true) and
+ * cv::contourArea(contour, true), but reads each point once instead of once per feature.
+ *
+ * @param dx, dy Image gradients, as from computeGradient.
+ * @param out_curvature Curvature at each point, as from contourCurvature.
+ */
+ContourFeatures contourFeatures(const ContourSoA& contour,
+    const cv::Mat1f& dx, const cv::Mat1f& dy, std::vector<float>& out_curvature);
+
+} // namespace komb
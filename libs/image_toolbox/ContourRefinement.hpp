@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include <common/ArenaAllocator.hpp>
+#include <common/TaskScheduler.hpp>
+
+#include "Contour.hpp"
+
+namespace komb {
+
+/// Search parameters for refineContourPointsSubpix.
+struct SubpixelSearchParams
+{
+    int search_radius = 4; ///< Max distance in pixels to move a point along the gradient.
+};
+
+/**
+ * @brief Gradient field over a SubpixelRefiner with full-frame gradient images.
+ *
+ * The refinement engine is templated on the gradient field so that other storage
+ * (like lazily computed tiles) can be plugged in. A field must provide cols(), rows()
+ * and a sampler() with dx(x, y), dy(x, y) and magnitude(x, y) for integer pixels inside
+ * the image. Samplers are created once per batch of points, so they can cache state.
+ * Fields whose samplers have no state set kStatelessSampler so that sampling is vectorized.
+ */
+class DenseGradientField
+{
+public:
+    static const bool kStatelessSampler = true;
+
+    explicit DenseGradientField(const SubpixelRefiner& refiner) : refiner_(refiner) {}
+
+    int cols() const { return refiner_.gradient_magnitude.cols; }
+    int rows() const { return refiner_.gradient_magnitude.rows; }
+
+    class Sampler
+    {
+    public:
+        explicit Sampler(const SubpixelRefiner& refiner) : refiner_(refiner) {}
+
+        float dx(int x, int y) const { return refiner_.dx(y, x); }
+        float dy(int x, int y) const { return refiner_.dy(y, x); }
+        float magnitude(int x, int y) const { return refiner_.gradient_magnitude(y, x); }
+
+    private:
+        const SubpixelRefiner& refiner_;
+    };
+
+    Sampler sampler() const { return Sampler(refiner_); }
+
+private:
+    const SubpixelRefiner& refiner_;
+};
+
+/// Bilinear interpolation. x and y must be inside [0, cols - 1] x [0, rows - 1].
+template<typename Sampler>
+inline float sampleMagnitudeBilinear(Sampler& sampler, float x, float y, int cols, int rows)
+{
+    const int x0 = std::min(static_cast<int>(x), cols - 2);
+    const int y0 = std::min(static_cast<int>(y), rows - 2);
+    const float fx = x - static_cast<float>(x0);
+    const float fy = y - static_cast<float>(y0);
+    const float top =
+        (1 - fx) * sampler.magnitude(x0, y0) + fx * sampler.magnitude(x0 + 1, y0);
+    const float bottom =
+        (1 - fx) * sampler.magnitude(x0, y0 + 1) + fx * sampler.magnitude(x0 + 1, y0 + 1);
+    return (1 - fy) * top + fy * bottom;
+}
+
+/// The unit gradient direction at the pixel closest to (x, y), or zero outside the image or on
+/// a zero gradient.
+template<typename Sampler>
+inline void sampleGradientDirection(
+    Sampler& sampler, float x, float y, int cols, int rows, float& out_dir_x, float& out_dir_y)
+{
+    out_dir_x = 0.0f;
+    out_dir_y = 0.0f;
+    const int pixel_x = static_cast<int>(std::lround(x));
+    const int pixel_y = static_cast<int>(std::lround(y));
+    if (pixel_x < 0 || pixel_y < 0 || pixel_x >= cols || pixel_y >= rows)
+    {
+        return;
+    }
+    const float gx = sampler.dx(pixel_x, pixel_y);
+    const float gy = sampler.dy(pixel_x, pixel_y);
+    const float norm = std::sqrt(gx * gx + gy * gy);
+    if (norm > 0)
+    {
+        out_dir_x = gx / norm;
+        out_dir_y = gy / norm;
+    }
+}
+
+/// Find the gradient direction of each point, and sample the magnitude at
+/// xs + offset * dir_xs, ys + offset * dir_ys, clamped to the image, for each offset in
+/// [-radius, radius]. out_samples[k * n + i] is the magnitude at offset k - radius from point i.
+template<typename Sampler>
+inline void sampleSearchWindows(
+    std::true_type /*stateless_sampler*/, Sampler& sampler, int radius,
+    const float* xs, const float* ys, size_t n, int cols, int rows,
+    float* out_dir_xs, float* out_dir_ys, float* out_samples)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        sampleGradientDirection(sampler, xs[i], ys[i], cols, rows, out_dir_xs[i], out_dir_ys[i]);
+    }
+
+    // One offset for all points at a time, which vectorizes.
+    const float max_x = static_cast<float>(cols - 1);
+    const float max_y = static_cast<float>(rows - 1);
+    for (int k = 0; k < 2 * radius + 1; ++k)
+    {
+        const float offset = static_cast<float>(k - radius);
+        float* samples = out_samples + static_cast<size_t>(k) * n;
+#ifdef _OPENMP
+        #pragma omp simd
+#endif
+        for (size_t i = 0; i < n; ++i)
+        {
+            const float x = std::min(std::max(xs[i] + offset * out_dir_xs[i], 0.0f), max_x);
+            const float y = std::min(std::max(ys[i] + offset * out_dir_ys[i], 0.0f), max_y);
+            samples[i] = sampleMagnitudeBilinear(sampler, x, y, cols, rows);
+        }
+    }
+}
+
+template<typename Sampler>
+inline void sampleSearchWindows(
+    std::false_type /*stateless_sampler*/, Sampler& sampler, int radius,
+    const float* xs, const float* ys, size_t n, int cols, int rows,
+    float* out_dir_xs, float* out_dir_ys, float* out_samples)
+{
+    // One point at a time, so that a sampler that caches tiles walks along the contour once,
+    // instead of once for the directions and once per offset.
+    const float max_x = static_cast<float>(cols - 1);
+    const float max_y = static_cast<float>(rows - 1);
+    for (size_t i = 0; i < n; ++i)
+    {
+        sampleGradientDirection(sampler, xs[i], ys[i], cols, rows, out_dir_xs[i], out_dir_ys[i]);
+        for (int k = 0; k < 2 * radius + 1; ++k)
+        {
+            const float offset = static_cast<float>(k - radius);
+            const float x = std::min(std::max(xs[i] + offset * out_dir_xs[i], 0.0f), max_x);
+            const float y = std::min(std::max(ys[i] + offset * out_dir_ys[i], 0.0f), max_y);
+            out_samples[static_cast<size_t>(k) * n + i] =
+                sampleMagnitudeBilinear(sampler, x, y, cols, rows);
+        }
+    }
+}
+
+/**
+ * @brief Move each point to the maximum of the gradient magnitude along the gradient direction.
+ *
+ * Points are processed as a batch in structure-of-arrays form: the magnitude is sampled
+ * bilinearly along the search window of every point (vectorized for stateless samplers),
+ * then each point climbs to the closest local maximum in its window and a parabola is fitted
+ * around it.
+ * Points outside the image or on a zero gradient are left as they are.
+ * The temporaries are taken from the scratch arena of the calling thread.
+ */
+template<typename GradientField, typename Allocator>
+void refineContourPointsSubpix(
+    const GradientField& field,
+    std::vector<float, Allocator>& io_xs,
+    std::vector<float, Allocator>& io_ys,
+    const SubpixelSearchParams& params = SubpixelSearchParams())
+{
+    const int cols = field.cols();
+    const int rows = field.rows();
+    const size_t n = io_xs.size();
+    if (n == 0 || cols < 2 || rows < 2)
+    {
+        return;
+    }
+
+    const int radius = params.search_radius;
+    const int window = 2 * radius + 1;
+    auto sampler = field.sampler();
+
+    ScratchScope scratch;
+    ArenaVector<float> dir_xs(n, scratch.resource());
+    ArenaVector<float> dir_ys(n, scratch.resource());
+    ArenaVector<float> samples(static_cast<size_t>(window) * n, scratch.resource());
+    sampleSearchWindows(
+        std::integral_constant<bool, GradientField::kStatelessSampler>(), sampler, radius,
+        io_xs.data(), io_ys.data(), n, cols, rows, dir_xs.data(), dir_ys.data(),
+        samples.data());
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (dir_xs[i] == 0.0f && dir_ys[i] == 0.0f)
+        {
+            continue;
+        }
+        auto sample = [&](int k) { return samples[static_cast<size_t>(k) * n + i]; };
+
+        int k = radius;
+        while (k + 1 < window && sample(k + 1) > sample(k)) { ++k; }
+        while (k > 0 && sample(k - 1) > sample(k)) { --k; }
+
+        // Fit z = a + bx + cx^2 through the maximum and its neighbours, the peak is at -b / 2c.
+        float offset = static_cast<float>(k - radius);
+        if (0 < k && k + 1 < window)
+        {
+            const float zm1 = sample(k - 1);
+            const float z0 = sample(k);
+            const float z1 = sample(k + 1);
+            const float denominator = zm1 + z1 - 2 * z0;
+            if (denominator < 0)
+            {
+                const float delta = 0.5f * (zm1 - z1) / denominator;
+                if (std::abs(delta) < 1.0f)
+                {
+                    offset += delta;
+                }
+            }
+        }
+        io_xs[i] += offset * dir_xs[i];
+        io_ys[i] += offset * dir_ys[i];
+    }
+}
+
+/// Remove points closer than min_distance to the previous kept point, unless fewer than 3 remain.
+/// Works in place, so it allocates nothing whatever the allocator of the contour.
+template<typename Allocator>
+void removeClosePoints(std::vector<cv::Point2f, Allocator>& io_contour, float min_distance)
+{
+    if (io_contour.empty())
+    {
+        return;
+    }
+
+    // Count first, so that the contour is left untouched when too few points would remain.
+    const float min_distance_sq = min_distance * min_distance;
+    auto is_far = [min_distance_sq](const cv::Point2f& p, const cv::Point2f& prev_point)
+    {
+        const cv::Point2f d = p - prev_point;
+        return d.x * d.x + d.y * d.y > min_distance_sq;
+    };
+    size_t num_kept = 0;
+    cv::Point2f prev_point = io_contour.back();
+    for (const auto& p : io_contour)
+    {
+        if (is_far(p, prev_point))
+        {
+            num_kept += 1;
+            prev_point = p;
+        }
+    }
+    if (num_kept < 3 || num_kept == io_contour.size())
+    {
+        return;
+    }
+
+    // Compare with the original last point, it is only overwritten once all points are read.
+    prev_point = io_contour.back();
+    size_t out = 0;
+    for (size_t i = 0; i < io_contour.size(); ++i)
+    {
+        const cv::Point2f p = io_contour[i];
+        if (is_far(p, prev_point))
+        {
+            io_contour[out++] = p;
+            prev_point = p;
+        }
+    }
+    io_contour.resize(num_kept);
+}
+
+/// Refine all points of a contour as one batch, then remove points that ended up too close.
+template<typename GradientField, typename Allocator>
+void refineContourSubpixBatched(
+    std::vector<cv::Point2f, Allocator>& io_contour, const GradientField& field,
+    const SubpixelSearchParams& params = SubpixelSearchParams())
+{
+    if (io_contour.empty())
+    {
+        return;
+    }
+
+    ScratchScope scratch;
+    ArenaVector<float> xs(io_contour.size(), scratch.resource());
+    ArenaVector<float> ys(io_contour.size(), scratch.resource());
+    for (size_t i = 0; i < io_contour.size(); ++i)
+    {
+        xs[i] = io_contour[i].x;
+        ys[i] = io_contour[i].y;
+    }
+    refineContourPointsSubpix(field, xs, ys, params);
+    for (size_t i = 0; i < io_contour.size(); ++i)
+    {
+        io_contour[i] = cv::Point2f(xs[i], ys[i]);
+    }
+
+    removeClosePoints(io_contour, 0.25f);
+}
+
+/// Refine each contour with refineContourSubpixBatched, in parallel over contours.
+template<typename GradientField, typename ContourVector>
+void refineContoursSubpixBatched(
+    ContourVector& io_contours, const GradientField& field,
+    const SubpixelSearchParams& params = SubpixelSearchParams())
+{
+    globalTaskScheduler().parallelFor(io_contours.size(), 1, [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            refineContourSubpixBatched(io_contours[i], field, params);
+        }
+    });
+}
+
+} // namespace komb
@@ -0,0 +1,272 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <common/Random.hpp>
+#include <geometry_toolbox/Angle.hpp>
+#include <image_toolbox/Contour.hpp>
+#include <image_toolbox/ContourFeatures.hpp>
+#include <image_toolbox/ContourRefinement.hpp>
+#include <image_toolbox/LazyGradientField.hpp>
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(image_toolbox)
+
+BOOST_AUTO_TEST_CASE(RefineContourOnSmoothStepEdge)
+{
+    // Vertical edge between dark and bright at a subpixel position.
+    const float kEdgeX = 20.3f;
+    cv::Mat1b image(40, 40);
+    for (int y = 0; y < image.rows; ++y)
+    {
+        for (int x = 0; x < image.cols; ++x)
+        {
+            const float t = (static_cast<float>(x) - kEdgeX) / 0.8f;
+            image(y, x) = cv::saturate_cast<uint8_t>(255.0f / (1.0f + std::exp(-t)));
+        }
+    }
+
+    komb::Contours contours(2);
+    for (int y = 5; y < 35; ++y)
+    {
+        contours[0].emplace_back(18, y); // Two pixels left of the edge.
+        contours[1].emplace_back(22, y); // Two pixels right of the edge.
+    }
+
+    const komb::Contours2f refined = komb::refineContoursSubpix(image, contours, 3);
+    BOOST_REQUIRE_EQUAL(refined.size(), 2u);
+    for (const auto& contour : refined)
+    {
+        BOOST_REQUIRE_EQUAL(contour.size(), 30u);
+        for (const auto& p : contour)
+        {
+            BOOST_CHECK_SMALL(p.x - kEdgeX, 0.2f);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(RemoveClosePointsInArenaContour)
+{
+    komb::MonotonicArena arena;
+    komb::ArenaContour2f contour({{0, 0}, {0.1f, 0}, {5, 0}, {5, 5}, {5.1f, 5.1f}, {0, 5}},
+        arena);
+    komb::removeClosePoints(contour, 0.25f);
+    const komb::Contour2f expected{{0, 0}, {5, 0}, {5, 5}, {0, 5}};
+    BOOST_REQUIRE_EQUAL(contour.size(), expected.size());
+    BOOST_CHECK(std::equal(contour.begin(), contour.end(), expected.begin()));
+
+    // Too few points would remain, so the contour is left as it is.
+    komb::Contour2f tiny{{0, 0}, {0.1f, 0}, {5, 0}, {5.1f, 0}};
+    komb::removeClosePoints(tiny, 0.25f);
+    BOOST_CHECK_EQUAL(tiny.size(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE(LazyGradientFieldMatchesDense)
+{
+    cv::Mat1b image(300, 200);
+    cv::randu(image, 0, 256);
+    const int kKernelSize = 5;
+    const komb::SubpixelRefiner refiner = komb::makeSubpixelRefiner(image, kKernelSize);
+    komb::LazyGradientField lazy_field(image, kKernelSize, 4);
+
+    auto sampler = lazy_field.sampler();
+    for (int y = 0; y < image.rows; y += 7)
+    {
+        for (int x = 0; x < image.cols; x += 3)
+        {
+            BOOST_CHECK_SMALL(sampler.dx(x, y) - refiner.dx(y, x), 1e-4f);
+            BOOST_CHECK_SMALL(sampler.dy(x, y) - refiner.dy(y, x), 1e-4f);
+            BOOST_CHECK_SMALL(sampler.magnitude(x, y) - refiner.gradient_magnitude(y, x), 1e-4f);
+        }
+    }
+
+    // A contour in one corner should only touch the tiles around it.
+    komb::Contours2f contours{{{10, 10}, {30, 10}, {30, 30}, {10, 30}}};
+    komb::LazyGradientField corner_field(image, kKernelSize);
+    komb::refineContoursSubpixBatched(contours, corner_field);
+    BOOST_CHECK_EQUAL(corner_field.numComputedTiles(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(LazyGradientFieldComputesEachTileOnce)
+{
+    // A horizontal band between two smooth edges at y = 32.3 and y = 96.3.
+    const int kTile = komb::LazyGradientField::kTileSize;
+    cv::Mat1b image(2 * kTile, 75 * kTile);
+    for (int y = 0; y < image.rows; ++y)
+    {
+        const float t = std::min(static_cast<float>(y) - 32.3f, 96.3f - static_cast<float>(y));
+        image.row(y).setTo(cv::saturate_cast<uint8_t>(255.0f / (1.0f + std::exp(-t / 0.8f))));
+    }
+
+    // Out along the top edge and back along the bottom edge, through 2 x 71 tiles. That is more
+    // than the cache holds, so every pass over the contour would recompute all of them.
+    komb::Contours2f contours(1);
+    for (int x = 10; x <= 70 * kTile + 10; ++x)
+    {
+        contours[0].emplace_back(static_cast<float>(x), 32.0f);
+    }
+    for (int x = 70 * kTile + 10; x >= 10; --x)
+    {
+        contours[0].emplace_back(static_cast<float>(x), 96.0f);
+    }
+
+    komb::LazyGradientField field(image, 5);
+    komb::refineContoursSubpixBatched(contours, field);
+    BOOST_CHECK_EQUAL(field.numComputedTiles(), 2u * 71u);
+    for (const auto& p : contours[0])
+    {
+        BOOST_REQUIRE_SMALL(p.y - (p.y < 64.0f ? 32.3f : 96.3f), 0.2f);
+    }
+}
+
+double referenceOverlapFraction(const komb::Contour2f& contour_a, const komb::Contour2f& contour_b)
+{
+    std::set<cv::Point, komb::PointPositionComparator> set_a(contour_a.begin(), contour_a.end());
+    std::set<cv::Point, komb::PointPositionComparator> set_b(contour_b.begin(), contour_b.end());
+    std::vector<cv::Point> intersection;
+    std::set_intersection(set_a.begin(), set_a.end(), set_b.begin(), set_b.end(),
+        std::back_inserter(intersection), komb::PointPositionComparator());
+    return double(intersection.size()) * 2.0 / double(set_a.size() + set_b.size());
+}
+
+BOOST_AUTO_TEST_CASE(ContourOverlapMatchesSetIntersection)
+{
+    // Random walks, some of them sharing a prefix, including negative coordinates.
+    komb::RandomEngine rng = komb::getRandomEngine(1);
+    std::uniform_real_distribution<float> start(-20.0f, 80.0f);
+    std::uniform_real_distribution<float> step(-1.5f, 1.5f);
+    komb::Contours2f contours;
+    for (int i = 0; i < 40; ++i)
+    {
+        komb::Contour2f contour;
+        if (i % 3 == 1)
+        {
+            contour.assign(contours.back().begin(), contours.back().begin() + 20);
+        }
+        else
+        {
+            contour.emplace_back(start(rng), start(rng));
+        }
+        while (contour.size() < 60)
+        {
+            contour.push_back(contour.back() + cv::Point2f(step(rng), step(rng)));
+        }
+        contours.push_back(contour);
+    }
+    contours.emplace_back();
+
+    const double kMinFraction = 0.1;
+    std::vector<komb::ContourOverlap> expected;
+    for (size_t a = 0; a < contours.size(); ++a)
+    {
+        for (size_t b = a + 1; b < contours.size(); ++b)
+        {
+            const double fraction = komb::contourOverlapFraction(contours[a], contours[b]);
+            if (contours[a].empty() || contours[b].empty())
+            {
+                BOOST_CHECK_EQUAL(fraction, 0.0);
+                continue;
+            }
+            BOOST_CHECK_CLOSE(fraction, referenceOverlapFraction(contours[a], contours[b]), 1e-9);
+            if (fraction > 0 && fraction >= kMinFraction)
+            {
+                expected.push_back({a, b, fraction});
+            }
+        }
+    }
+    BOOST_REQUIRE(!expected.empty());
+
+    const auto overlaps = komb::findOverlappingContours(contours, kMinFraction);
+    BOOST_REQUIRE_EQUAL(overlaps.size(), expected.size());
+    for (size_t i = 0; i < overlaps.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(overlaps[i].index_a, expected[i].index_a);
+        BOOST_CHECK_EQUAL(overlaps[i].index_b, expected[i].index_b);
+        BOOST_CHECK_CLOSE(overlaps[i].fraction, expected[i].fraction, 1e-9);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SegmentSquareByDirectionality)
+{
+    // A 10x10 square starting in the middle of the top side, so the top side wraps around.
+    komb::Contour2f contour;
+    for (int x = 5; x < 10; ++x) { contour.emplace_back(x, 0); }
+    for (int y = 0; y < 10; ++y) { contour.emplace_back(10, y); }
+    for (int x = 10; x > 0; --x) { contour.emplace_back(x, 10); }
+    for (int y = 10; y > 0; --y) { contour.emplace_back(0, y); }
+    for (int x = 0; x < 5; ++x) { contour.emplace_back(x, 0); }
+
+    std::vector<komb::ContourSegment> segments;
+    komb::segmentContourByDirectionality(contour, 0.3f, segments);
+    BOOST_REQUIRE_EQUAL(segments.size(), 4u);
+    BOOST_CHECK(segments[0].end > contour.size());
+
+    size_t num_points = 0;
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        num_points += segments[i].size();
+        const size_t next = (i + 1) % segments.size();
+        BOOST_CHECK_EQUAL(segments[next].begin, segments[i].end % contour.size());
+    }
+    BOOST_CHECK_EQUAL(num_points, contour.size());
+
+    const komb::Contours2f split = komb::splitContourByDirectionality(contour, 0.3f);
+    BOOST_REQUIRE_EQUAL(split.size(), segments.size());
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        BOOST_CHECK(split[i] == komb::segmentPoints(contour, segments[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ContourFeaturesMatchSeparateComputations)
+{
+    cv::Mat1b image(100, 120);
+    cv::randu(image, 0, 256);
+    const komb::SubpixelRefiner refiner = komb::makeSubpixelRefiner(image, 3);
+
+    // A noisy ellipse that partly leaves the image.
+    komb::RandomEngine rng = komb::getRandomEngine(2);
+    std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+    komb::Contour2f contour;
+    for (int i = 0; i < 200; ++i)
+    {
+        const float angle = komb::kTau_f * static_cast<float>(i) / 200;
+        contour.emplace_back(80 + 50 * std::cos(angle) + noise(rng),
+            50 + 30 * std::sin(angle) + noise(rng));
+    }
+
+    const komb::ContourSoA points(contour);
+    BOOST_CHECK(points.toContour2f() == contour);
+
+    std::vector<float> curvature;
+    const komb::ContourFeatures features =
+        komb::contourFeatures(points, refiner.dx, refiner.dy, curvature);
+    const std::vector<float> expected_curvature = komb::contourCurvature(contour);
+    BOOST_REQUIRE_EQUAL(curvature.size(), expected_curvature.size());
+    for (size_t i = 0; i < curvature.size(); ++i)
+    {
+        BOOST_CHECK_CLOSE(curvature[i], expected_curvature[i], 1e-2);
+    }
+    BOOST_CHECK_CLOSE(features.cross_gradient,
+        komb::contourCrossGradient(refiner.dx, refiner.dy, contour), 1e-3);
+    BOOST_CHECK_CLOSE(features.length, cv::arcLength(contour, true), 1e-3);
+    BOOST_CHECK_CLOSE(features.signed_area, cv::contourArea(contour, true), 1e-3);
+
+    const komb::ContourFeatures shape = komb::contourShapeFeatures(points);
+    BOOST_CHECK_CLOSE(shape.length, features.length, 1e-6);
+    BOOST_CHECK_CLOSE(shape.signed_area, features.signed_area, 1e-6);
+    BOOST_CHECK_CLOSE(shape.bounding_box.x, 30.0f, 2.0f);
+    BOOST_CHECK_CLOSE(shape.bounding_box.width, 100.0f, 2.0f);
+    BOOST_CHECK_CLOSE(shape.bounding_box.height, 60.0f, 2.0f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,44 +1,113 @@
 #include "Convert.hpp"
 
 #include <algorithm>
+#include <cstdint>
 #include <vector>
 
 #include <opencv2/opencv.hpp>
 
+#include <common/algorithm/ExecutionPolicy.hpp>
 #include <common/Logging.hpp>
 
 namespace komb {
 
 std::vector<cv::Mat1b> rgb2Cmyk(const cv::Mat3b& img)
 {
-    // Adapted from https://gist.github.com/wyudong/9c392578c6247e7d1d28
-    std::vector<cv::Mat1b> ret;
-    // Allocate CMYK to store 4 components
+    std::vector<cv::Mat1b> cmyk;
     for (int i = 0; i < 4; ++i)
     {
-        ret.push_back(cv::Mat(img.size(), CV_8UC1));
+        cmyk.emplace_back(img.size());
     }
 
-    std::vector<cv::Mat> rgb;
-    cv::split(img, rgb);
+    // k = 1 - max(r, g, b) and c = (1 - r - k) / (1 - k) = (max - r) / max, etc.
+    // The loop reads the interleaved pixels directly and vectorizes, rows run in parallel.
+    detail::forEachRow(execution::par, static_cast<size_t>(img.rows),
+        static_cast<size_t>(img.cols), [&](size_t y)
+    {
+        const uint8_t* bgr = img.ptr<uint8_t>(static_cast<int>(y));
+        uint8_t* c_row = cmyk[0][static_cast<int>(y)];
+        uint8_t* m_row = cmyk[1][static_cast<int>(y)];
+        uint8_t* y_row = cmyk[2][static_cast<int>(y)];
+        uint8_t* k_row = cmyk[3][static_cast<int>(y)];
+        KOMB_PRAGMA_OMP_SIMD
+        for (int x = 0; x < img.cols; ++x)
+        {
+            const float b = bgr[3 * x + 0];
+            const float g = bgr[3 * x + 1];
+            const float r = bgr[3 * x + 2];
+            const float max = std::max(std::max(r, g), b);
+            // Pure black has no color, rather than 0 / 0.
+            const float scale = max > 0 ? 255.0f / max : 0.0f;
+            c_row[x] = static_cast<uint8_t>((max - r) * scale + 0.5f);
+            m_row[x] = static_cast<uint8_t>((max - g) * scale + 0.5f);
+            y_row[x] = static_cast<uint8_t>((max - b) * scale + 0.5f);
+            k_row[x] = static_cast<uint8_t>(255.0f - max);
+        }
+    });
+
+    return cmyk;
+}
+
+cv::Mat3b cmyk2Rgb(const std::vector<cv::Mat1b>& cmyk)
+{
+    CHECK_EQ(cmyk.size(), 4u);
+    for (const auto& plane : cmyk)
+    {
+        CHECK_EQ(plane.size(), cmyk[0].size());
+    }
+
+    // r = (1 - c) * (1 - k), in integers as round((255 - c) * (255 - k) / 255).
+    auto mul255 = [](int a, int b)
+    {
+        const int t = a * b + 128;
+        return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+    };
 
-    for (int i = 0; i < img.rows; ++i)
+    cv::Mat3b img(cmyk[0].size());
+    detail::forEachRow(execution::par, static_cast<size_t>(img.rows),
+        static_cast<size_t>(img.cols), [&](size_t y)
     {
-        for (int j = 0; j < img.cols; ++j)
+        const uint8_t* c_row = cmyk[0][static_cast<int>(y)];
+        const uint8_t* m_row = cmyk[1][static_cast<int>(y)];
+        const uint8_t* y_row = cmyk[2][static_cast<int>(y)];
+        const uint8_t* k_row = cmyk[3][static_cast<int>(y)];
+        uint8_t* bgr = img.ptr<uint8_t>(static_cast<int>(y));
+        KOMB_PRAGMA_OMP_SIMD
+        for (int x = 0; x < img.cols; ++x)
         {
-            float r = rgb[2].at<uchar>(i, j) / 255.0f;
-            float g = rgb[1].at<uchar>(i, j) / 255.0f;
-            float b = rgb[0].at<uchar>(i, j) / 255.0f;
-            float k = std::min(std::min(1 - r, 1 - g), 1 - b);
-
-            ret[0].at<uchar>(i, j) = (1 - r - k) / (1 - k) * 255.0f;
-            ret[1].at<uchar>(i, j) = (1 - g - k) / (1 - k) * 255.0f;
-            ret[2].at<uchar>(i, j) = (1 - b - k) / (1 - k) * 255.0f;
-            ret[3].at<uchar>(i, j) = k * 255.0f;
+            const int white = 255 - k_row[x];
+            bgr[3 * x + 0] = mul255(255 - y_row[x], white);
+            bgr[3 * x + 1] = mul255(255 - m_row[x], white);
+            bgr[3 * x + 2] = mul255(255 - c_row[x], white);
         }
+    });
+    return img;
+}
+
+std::vector<cv::Mat1f> bgrToPlanarFloat(const cv::Mat3b& img, float scale)
+{
+    std::vector<cv::Mat1f> planes;
+    for (int i = 0; i < 3; ++i)
+    {
+        planes.emplace_back(img.size());
     }
 
-    return ret;
+    detail::forEachRow(execution::par, static_cast<size_t>(img.rows),
+        static_cast<size_t>(img.cols), [&](size_t y)
+    {
+        const uint8_t* bgr = img.ptr<uint8_t>(static_cast<int>(y));
+        float* b_row = planes[0][static_cast<int>(y)];
+        float* g_row = planes[1][static_cast<int>(y)];
+        float* r_row = planes[2][static_cast<int>(y)];
+        KOMB_PRAGMA_OMP_SIMD
+        for (int x = 0; x < img.cols; ++x)
+        {
+            b_row[x] = scale * bgr[3 * x + 0];
+            g_row[x] = scale * bgr[3 * x + 1];
+            r_row[x] = scale * bgr[3 * x + 2];
+        }
+    });
+    return planes;
 }
 
 cv::Mat convertAndRescale(const cv::Mat& src)
@@ -84,12 +153,9 @@ cv::Mat toFloatMat(const cv::Mat& mat)
 
 cv::Mat3b ignoreAlpha(const cv::Mat4b& img)
 {
-    cv::Mat1b channels[4];
-    cv::split(img, channels);
-
+    // One pass over the pixels, vectorized and parallel within OpenCV.
     cv::Mat3b out;
-    cv::merge(channels, 3, out);
-
+    cv::cvtColor(img, out, cv::COLOR_BGRA2BGR);
     return out;
 }
 
@@ -6,8 +6,16 @@
 
 namespace komb {
 
+/// Split an interleaved BGR image into C, M, Y and K planes, in that order.
+/// Black pixels get c = m = y = 0 and k = 255.
 std::vector<cv::Mat1b> rgb2Cmyk(const cv::Mat3b& img);
 
+/// The inverse of rgb2Cmyk: interleave C, M, Y and K planes into a BGR image.
+cv::Mat3b cmyk2Rgb(const std::vector<cv::Mat1b>& cmyk);
+
+/// Split an interleaved BGR image into B, G and R float planes, multiplied by scale.
+std::vector<cv::Mat1f> bgrToPlanarFloat(const cv::Mat3b& img, float scale = 1.0f / 255.0f);
+
 cv::Mat convertAndRescale(const cv::Mat& src);
 void convertAndRescale(const cv::Mat& src, cv::Mat& out_image);
 cv::Mat rescale(const cv::Mat& src);
@@ -2,16 +2,31 @@
 
 #include <algorithm>
 #include <array>
+#include <memory>
+#include <new>
 #include <type_traits>
-#include <valarray>
+#include <utility>
 
 #include <Eigen/Geometry>
 
 #include <common/algorithm/Container.hpp>
 #include <common/ArrayPointer.hpp>
+#include <common/MemoryResource.hpp>
+
+#include "ImageStorage.hpp"
 
 namespace komb {
 
+/**
+ * @brief Dense image with the pixels of each row after each other, and no padding between rows.
+ *
+ * Images that allocate their own pixels have them 64 byte aligned, with padding after the last
+ * row for SIMD tails, see ImageStorage. An image can also be a non-owning view, see view(), or
+ * share the pixels of a reference counted buffer, see share(). Views and shared images have no
+ * padding, capacity() == size(), and only the alignment their owner gives, e.g. 16 bytes for
+ * the buffer of a cv::Mat. Kernels that load or store past the last pixel must check
+ * capacity().
+ */
 template<typename T>
 class Image
 {
@@ -20,58 +35,107 @@ public:
     using iterator = T*;
     using const_iterator = const T*;
 
-    Image() : width_(0), height_(0), pixels_(0) {}
+    Image() : width_(0), height_(0) {}
 
     Image(size_t width_arg, size_t height_arg)
-        : width_(width_arg), height_(height_arg), pixels_(width_arg * height_arg) {}
+        : Image(width_arg, height_arg, kUninitialized)
+    {
+        std::fill_n(data(), size(), T());
+    }
 
     Image(size_t width_arg, size_t height_arg, const T& value)
-        : width_(width_arg), height_(height_arg), pixels_(value, width_arg * height_arg) {}
+        : Image(width_arg, height_arg, kUninitialized)
+    {
+        std::fill_n(data(), size(), value);
+    }
 
     Image(size_t width_arg, size_t height_arg, const T* value)
-        : width_(width_arg), height_(height_arg), pixels_(value, width_arg * height_arg) {}
+        : width_(width_arg), height_(height_arg)
+        , storage_(width_arg * height_arg, defaultMemoryResource())
+    {
+        std::uninitialized_copy_n(value, size(), data());
+    }
+
+    /// Skips the initial fill, for images that are about to be overwritten anyway.
+    /// Temporaries that are allocated over and over can come from a PoolMemoryResource.
+    Image(size_t width_arg, size_t height_arg, Uninitialized,
+        MemoryResource& resource = defaultMemoryResource())
+        : width_(width_arg), height_(height_arg), storage_(width_arg * height_arg, resource)
+    {
+        for (T& pixel : *this)
+        {
+            new (&pixel) T;
+        }
+    }
 
     explicit Image(const std::array<size_t, 2>& dimensions)
-        : width_(dimensions[0]), height_(dimensions[1])
-        , pixels_(dimensions[0] * dimensions[1]) {}
+        : Image(dimensions[0], dimensions[1]) {}
 
     Image(const std::array<size_t, 2>& dimensions, const T& value)
-        : width_(dimensions[0]), height_(dimensions[1])
-        , pixels_(value, dimensions[0] * dimensions[1]) {}
+        : Image(dimensions[0], dimensions[1], value) {}
 
     explicit Image(const ArrayPointer<const T, 2>& array_pointer)
         : Image(array_pointer.size(0), array_pointer.size(1), array_pointer.data())
     {}
 
-    T*       data()        {return std::begin(pixels_);}
-    const T* data()  const {return std::begin(pixels_);}
-    T*       begin()       {return std::begin(pixels_);}
-    const T* begin() const {return std::begin(pixels_);}
-    T*       end()         {return std::end(pixels_);}
-    const T* end()   const {return std::end(pixels_);}
+    /// Non-owning image of pixels that must outlive it. Copies of a view are owning.
+    /// Assigning to a view makes it owning, it does not write through to the viewed pixels.
+    static Image view(T* pixels, size_t width_arg, size_t height_arg)
+    {
+        Image image;
+        image.width_ = width_arg;
+        image.height_ = height_arg;
+        image.storage_ = ImageStorage<T>::view(pixels, width_arg * height_arg);
+        return image;
+    }
+
+    /// Shares pixels that owner keeps alive, e.g. the buffer of a cv::Mat, see shareImage.
+    /// Copies are owning deep copies, as for views.
+    static Image share(
+        T* pixels, size_t width_arg, size_t height_arg, std::shared_ptr<const void> owner)
+    {
+        Image image;
+        image.width_ = width_arg;
+        image.height_ = height_arg;
+        image.storage_ = ImageStorage<T>::shared(
+            pixels, width_arg * height_arg, std::move(owner));
+        return image;
+    }
+
+    T*       data()        {return storage_.data();}
+    const T* data()  const {return storage_.data();}
+    T*       begin()       {return data();}
+    const T* begin() const {return data();}
+    T*       end()         {return data() + size();}
+    const T* end()   const {return data() + size();}
+
+    size_t size()     const {return storage_.size();}
+    size_t width()    const {return width_;}
+    size_t height()   const {return height_;}
+    bool   empty()    const {return size() == 0;}
+    bool   ownsData() const {return storage_.ownsData();}
 
-    size_t size()    const {return pixels_.size();}
-    size_t width()   const {return width_;}
-    size_t height()  const {return height_;}
-    bool   empty()   const {return size() == 0;}
+    /// Number of elements that may be touched from data(), including the SIMD padding.
+    /// Equal to size() for views and shared images, which have no padding.
+    size_t capacity() const {return storage_.capacity();}
 
-    T&       operator[](size_t i)       {return pixels_[i];}
-    const T& operator[](size_t i) const {return pixels_[i];}
+    T&       operator[](size_t i)       {return data()[i];}
+    const T& operator[](size_t i) const {return data()[i];}
 
-    T&       operator()(size_t x, size_t y)       { return pixels_[y * width_ + x]; }
-    const T& operator()(size_t x, size_t y) const { return pixels_[y * width_ + x]; }
+    T&       operator()(size_t x, size_t y)       { return data()[y * width_ + x]; }
+    const T& operator()(size_t x, size_t y) const { return data()[y * width_ + x]; }
 
     void swap(Image<T>& io_image)
     {
         std::swap(width_,  io_image.width_);
         std::swap(height_, io_image.height_);
-        std::swap(pixels_, io_image.pixels_);
+        storage_.swap(io_image.storage_);
     }
 
 private:
     size_t width_;
     size_t height_;
-    std::valarray<T> pixels_;
+    ImageStorage<T> storage_;
 };
 
 using Imageb = Image<bool>;
@@ -112,14 +176,14 @@ std::array<size_t, 2> dimensions(const Image<T>& image)
 
 inline Imaged convertToDouble(const Imagef& image_float)
 {
-    auto image_double = Imaged(image_float.width(), image_float.height());
+    auto image_double = Imaged(image_float.width(), image_float.height(), kUninitialized);
     cast(image_float, image_double);
     return image_double;
 }
 
 inline Imagef convertToFloat(const Imaged& image_double)
 {
-    auto image_float = Imagef(image_double.width(), image_double.height());
+    auto image_float = Imagef(image_double.width(), image_double.height(), kUninitialized);
     cast(image_double, image_float);
     return image_float;
 }
@@ -144,7 +208,7 @@ auto mapImage(const ImageIn& in, UnaryOperation op)
     const auto width  = image::width(in);
     const auto height = image::height(in);
 
-    auto out = Image<value_type_out>(width, height);
+    auto out = Image<value_type_out>(width, height, kUninitialized);
     transform(in, out, op);
     return out;
 }
@@ -156,11 +220,34 @@ auto mapImage(const ImageIn1& in1, const ImageIn2& in2, BinaryOperation op)
     using value_type_out = decltype(op(*in1.begin(), *in2.begin()));
     const auto width  = image::width(in1);
     const auto height = image::height(in1);
-    auto out = Image<value_type_out>(width, height);
+    auto out = Image<value_type_out>(width, height, kUninitialized);
     transform(in1, in2, out, op);
     return out;
 }
 
+/// Like mapImage, with an execution policy for transform, see ExecutionPolicy.hpp.
+template <execution::Kind kKind, typename ImageIn, typename UnaryOperation>
+auto mapImage(execution::Policy<kKind> policy, const ImageIn& in, UnaryOperation op)
+{
+    using value_type_in  = decltype(*in.begin());
+    using value_type_out = decltype(op(value_type_in{}));
+
+    auto out = Image<value_type_out>(image::width(in), image::height(in), kUninitialized);
+    transform(policy, in, out, op);
+    return out;
+}
+
+template <execution::Kind kKind, typename ImageIn1, typename ImageIn2, typename BinaryOperation>
+auto mapImage(
+    execution::Policy<kKind> policy, const ImageIn1& in1, const ImageIn2& in2, BinaryOperation op)
+{
+    CHECK_EQ(image::dimensions(in1), image::dimensions(in2));
+    using value_type_out = decltype(op(*in1.begin(), *in2.begin()));
+    auto out = Image<value_type_out>(image::width(in1), image::height(in1), kUninitialized);
+    transform(policy, in1, in2, out, op);
+    return out;
+}
+
 template <typename T, typename UnaryOperation>
 auto map(const Image<T>& in, UnaryOperation op)
 {
@@ -1,5 +1,6 @@
 #include "ImageIo.hpp"
 
+#include <algorithm>
 #include <limits>
 #include <string>
 #include <vector>
@@ -8,6 +9,7 @@
 #include <boost/filesystem.hpp>
 #include <opencv2/opencv.hpp>
 
+#include <common/algorithm/ExecutionPolicy.hpp>
 #include <common/algorithm/Range.hpp>
 #include <common/algorithm/Vector.hpp>
 #include <common/Json.hpp>
@@ -15,9 +17,11 @@
 #include <common/Units.hpp>
 #include <file_io_toolbox/FileIo.hpp>
 #include <file_io_toolbox/FileSystem.hpp>
+#include <file_io_toolbox/MappedFile.hpp>
 
 #include "Gamma.hpp"
 #include "Image.hpp"
+#include "ImagePrefetcher.hpp"
 #include "OpenCvTools.hpp"
 
 namespace komb {
@@ -35,12 +39,84 @@ cv::Mat_<uint16_t> readRawDepthPng(const fs::path& file_path)
     return readCvImage(file_path, cv::IMREAD_UNCHANGED);
 }
 
+/// Like cv::imread, but decodes straight from a memory mapping of the file.
+/// If the file can not be mapped, the reason is written to out_error and cv::imread is tried.
+static cv::Mat decodeImageFile(const fs::path& path, int mode, std::string* out_error = nullptr)
+{
+    const auto file = MappedFile::open(path, FileAccess::kSequential, out_error);
+    if (!file || file->size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+    {
+        return cv::imread(path.string(), mode);
+    }
+    return decodeCvImage(file->data(), file->size(), mode);
+}
+
+/// Log that an image could not be loaded, with the reason if it is known.
+static void logImageLoadError(const fs::path& path, const std::string& error)
+{
+    if (error.empty())
+    {
+        LOG(ERROR) << "Failed to load image at " << path;
+    }
+    else
+    {
+        LOG(ERROR) << "Failed to load image at " << path << ": " << error;
+    }
+}
+
+/// Rotate and flip an image as its EXIF orientation says, like cv::imread.
+static void applyExifOrientation(int orientation, cv::Mat& io_image)
+{
+    if (orientation >= 5)
+    {
+        // The image is stored transposed. cv::transpose can not work in place on non-square images.
+        cv::Mat transposed;
+        cv::transpose(io_image, transposed);
+        io_image = transposed;
+    }
+    switch (orientation)
+    {
+    case 2: cv::flip(io_image, io_image, 1);  break;
+    case 3: cv::flip(io_image, io_image, -1); break;
+    case 4: cv::flip(io_image, io_image, 0);  break;
+    case 6: cv::flip(io_image, io_image, 1);  break;
+    case 7: cv::flip(io_image, io_image, -1); break;
+    case 8: cv::flip(io_image, io_image, 0);  break;
+    default: break;
+    }
+}
+
+cv::Mat decodeCvImage(const uint8_t* data, size_t size, int mode)
+{
+    if (size == 0)
+    {
+        return cv::Mat();
+    }
+    CHECK_LE(size, static_cast<size_t>(std::numeric_limits<int>::max()));
+    // cv::imdecode only reads from the buffer.
+    const cv::Mat buffer(1, static_cast<int>(size), CV_8UC1, const_cast<uint8_t*>(data));
+
+    // cv::imread applies the EXIF orientation unless the mode says not to, but only some versions
+    // of cv::imdecode do, so it is applied here instead.
+    if (mode == cv::IMREAD_UNCHANGED || (mode & cv::IMREAD_IGNORE_ORIENTATION) != 0)
+    {
+        return cv::imdecode(buffer, mode);
+    }
+    cv::Mat image = cv::imdecode(buffer, mode | cv::IMREAD_IGNORE_ORIENTATION);
+    if (!image.empty())
+    {
+        applyExifOrientation(peekExifOrientation(data, size), image);
+    }
+    return image;
+}
+
 cv::Mat readCvImage(const fs::path& path, cv::ImreadModes mode)
 {
-    cv::Mat result = cv::imread(path.string(), mode);
+    std::string error;
+    cv::Mat result = decodeImageFile(path, mode, &error);
     if (result.empty())
     {
-        LOG(ERROR) << "Failed to load image at " << path;
+        logImageLoadError(path, error);
     }
     return result;
 }
@@ -49,11 +125,216 @@ cv::Mat readCvImageOrDie(const fs::path& path, cv::ImreadModes mode)
 {
     CHECK(fs::exists(path)) << "Missing image: " << path;
     CHECK(fs::is_regular_file(path)) << "Not a file: " << path;
-    cv::Mat result = cv::imread(path.string(), mode);
+    cv::Mat result = decodeImageFile(path, mode);
     CHECK(!result.empty()) << "Failed to load image at " << path;
     return result;
 }
 
+boost::optional<cv::Size> peekImageSize(const uint8_t* data, size_t size)
+{
+    auto read_uint16 = [data](size_t pos) { return (data[pos] << 8) | data[pos + 1]; };
+    auto read_uint32 = [&](size_t pos) { return (read_uint16(pos) << 16) | read_uint16(pos + 2); };
+
+    const uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (size >= 24 && std::equal(kPngSignature, kPngSignature + 8, data))
+    {
+        // The IHDR chunk comes first, starting with width and height.
+        return cv::Size(read_uint32(16), read_uint32(20));
+    }
+
+    if (size >= 4 && data[0] == 0xFF && data[1] == 0xD8)
+    {
+        // Walk the JPEG markers until the start of frame, which holds the size.
+        size_t pos = 2;
+        while (pos + 4 <= size && data[pos] == 0xFF)
+        {
+            const uint8_t marker = data[pos + 1];
+            if (marker == 0xFF)
+            {
+                pos += 1; // Fill byte.
+                continue;
+            }
+            const bool is_start_of_frame = 0xC0 <= marker && marker <= 0xCF &&
+                marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+            if (is_start_of_frame && pos + 9 <= size)
+            {
+                return cv::Size(read_uint16(pos + 7), read_uint16(pos + 5));
+            }
+            pos += 2 + static_cast<size_t>(read_uint16(pos + 2));
+        }
+    }
+
+    return boost::none;
+}
+
+/// The orientation tag of the first image file directory of TIFF data, as found in EXIF.
+static int tiffOrientation(const uint8_t* tiff, size_t size)
+{
+    const bool little_endian = size >= 8 && tiff[0] == 'I' && tiff[1] == 'I';
+    const bool big_endian = size >= 8 && tiff[0] == 'M' && tiff[1] == 'M';
+    if (!little_endian && !big_endian)
+    {
+        return 1;
+    }
+    auto read_uint16 = [&](size_t pos) -> size_t
+    {
+        return little_endian ? tiff[pos] | (tiff[pos + 1] << 8) : (tiff[pos] << 8) | tiff[pos + 1];
+    };
+    auto read_uint32 = [&](size_t pos) -> size_t
+    {
+        return little_endian ? read_uint16(pos) | (read_uint16(pos + 2) << 16)
+                             : (read_uint16(pos) << 16) | read_uint16(pos + 2);
+    };
+
+    const size_t kOrientationTag = 0x0112;
+    const size_t ifd = read_uint32(4);
+    if (ifd + 2 > size)
+    {
+        return 1;
+    }
+    const size_t num_entries = read_uint16(ifd);
+    for (size_t entry = ifd + 2; entry < ifd + 2 + 12 * num_entries && entry + 12 <= size;
+        entry += 12)
+    {
+        if (read_uint16(entry) == kOrientationTag)
+        {
+            // A SHORT, stored first in the value field.
+            const size_t orientation = read_uint16(entry + 8);
+            return 1 <= orientation && orientation <= 8 ? static_cast<int>(orientation) : 1;
+        }
+    }
+    return 1;
+}
+
+int peekExifOrientation(const uint8_t* data, size_t size)
+{
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+    {
+        return 1;
+    }
+
+    // Walk the JPEG markers until the APP1 segment with the EXIF data, which comes before the
+    // start of scan.
+    const uint8_t kExifHeader[6] = {'E', 'x', 'i', 'f', 0, 0};
+    size_t pos = 2;
+    while (pos + 4 <= size && data[pos] == 0xFF)
+    {
+        const uint8_t marker = data[pos + 1];
+        if (marker == 0xFF)
+        {
+            pos += 1; // Fill byte.
+            continue;
+        }
+        if (marker == 0xDA)
+        {
+            break;
+        }
+        const size_t length = static_cast<size_t>((data[pos + 2] << 8) | data[pos + 3]);
+        const size_t end = std::min(size, pos + 2 + length);
+        const bool is_exif = marker == 0xE1 && pos + 10 <= end &&
+            std::equal(kExifHeader, kExifHeader + 6, data + pos + 4);
+        if (is_exif)
+        {
+            return tiffOrientation(data + pos + 10, end - (pos + 10));
+        }
+        pos += 2 + length;
+    }
+    return 1;
+}
+
+int imageReductionFactor(int image_side, int min_side)
+{
+    for (int factor : {8, 4, 2})
+    {
+        // libjpeg rounds the scaled size up.
+        if ((image_side + factor - 1) / factor >= min_side)
+        {
+            return factor;
+        }
+    }
+    return 1;
+}
+
+static int reducedImreadMode(cv::ImreadModes mode, int factor)
+{
+    const bool color = mode == cv::IMREAD_COLOR;
+    switch (factor)
+    {
+    case 2:  return color ? cv::IMREAD_REDUCED_COLOR_2 : cv::IMREAD_REDUCED_GRAYSCALE_2;
+    case 4:  return color ? cv::IMREAD_REDUCED_COLOR_4 : cv::IMREAD_REDUCED_GRAYSCALE_4;
+    case 8:  return color ? cv::IMREAD_REDUCED_COLOR_8 : cv::IMREAD_REDUCED_GRAYSCALE_8;
+    default: return mode;
+    }
+}
+
+/// The reduction factor for decoding an encoded image with readReducedCvImage.
+static int reductionFactor(const MappedFile& file, int min_side)
+{
+    // The smaller side is used so that an EXIF rotation can not make the image too narrow.
+    const auto image_size = peekImageSize(file.data(), file.size());
+    return image_size
+        ? imageReductionFactor(std::min(image_size->width, image_size->height), min_side)
+        : 1;
+}
+
+cv::Mat readReducedCvImage(const fs::path& path, int min_side, cv::ImreadModes mode)
+{
+    CHECK(mode == cv::IMREAD_COLOR || mode == cv::IMREAD_GRAYSCALE) << "Unsupported mode " << mode;
+    std::string error;
+    const auto file = MappedFile::open(path, FileAccess::kSequential, &error);
+    if (!file)
+    {
+        logImageLoadError(path, error);
+        return cv::Mat();
+    }
+
+    const int factor = reductionFactor(*file, min_side);
+    cv::Mat result = decodeCvImage(file->data(), file->size(), reducedImreadMode(mode, factor));
+    if (result.empty())
+    {
+        LOG(ERROR) << "Failed to load image at " << path;
+    }
+    return result;
+}
+
+FullAndReducedImage readFullAndReducedCvImage(
+    const fs::path& path, int min_side, cv::ImreadModes mode)
+{
+    CHECK(mode == cv::IMREAD_COLOR || mode == cv::IMREAD_GRAYSCALE) << "Unsupported mode " << mode;
+    FullAndReducedImage result;
+    std::string error;
+    const auto file = MappedFile::open(path, FileAccess::kSequential, &error);
+    if (file)
+    {
+        result.full = decodeCvImage(file->data(), file->size(), mode);
+    }
+    if (result.full.empty())
+    {
+        logImageLoadError(path, error);
+        return result;
+    }
+
+    const int factor = reductionFactor(*file, min_side);
+    const bool is_jpeg = file->size() >= 2 && file->data()[0] == 0xFF && file->data()[1] == 0xD8;
+    if (factor == 1)
+    {
+        result.reduced = result.full;
+    }
+    else if (is_jpeg)
+    {
+        // Decoding the JPEG again at reduced scale is faster than downscaling the full image.
+        result.reduced =
+            decodeCvImage(file->data(), file->size(), reducedImreadMode(mode, factor));
+    }
+    else
+    {
+        // Other formats are downscaled by cv::imdecode anyway, so reuse the full decode.
+        const cv::Size size(result.full.cols / factor, result.full.rows / factor);
+        cv::resize(result.full, result.reduced, size, 0, 0, cv::INTER_AREA);
+    }
+    return result;
+}
+
 cv::Mat3b readCvImageBgrOrDie(const fs::path& path)
 {
     ERROR_CONTEXT("Image path", path.c_str());
@@ -94,40 +375,101 @@ Imagef readGrayImage(const fs::path& file_path)
     ERROR_CONTEXT("path", file_path.c_str());
     CHECK_F(fs::exists(file_path));
     CHECK_F(fileSizeBytes(file_path) != 0);
-    const cv::Mat1b image_1b = cv::imread(file_path.c_str(), CV_LOAD_IMAGE_GRAYSCALE);
+    const cv::Mat1b image_1b = decodeImageFile(file_path, cv::IMREAD_GRAYSCALE);
     CHECK_F(!image_1b.empty(), "Failed to load image at '%s'", file_path.c_str());
     CHECK(image_1b.isContinuous());
-    return mapImageFromCv(image_1b, linearFromSrgbByte);
+    return mapImageFromCv(execution::par_unseq, image_1b, linearFromSrgbByte);
 }
 
 Imagef readDepthImage(const fs::path& file_path)
 {
-    return makeImage(readDepthCvImage(file_path));
+    return shareImage(readDepthCvImage(file_path));
 }
 
-Imagef readAndAverageGrayImages(const fs::path& directory)
-{
-    const auto image_paths = getFilesInDir(directory, ".png");
-    CHECK_GT(image_paths.size(), 0u);
-    cv::Mat1d ir_sum;
+namespace {
 
-    for (const auto& image_path : image_paths)
+/// Running statistics with Welford's algorithm, so that the variance is numerically stable.
+struct RunningGrayStatistics
+{
+    cv::Mat1d mean;
+    cv::Mat1d sum_squared_deviations;
+    cv::Mat1f min;
+    cv::Mat1f max;
+    size_t    count = 0;
+
+    /// Add an 8 bit image, mapped to linear intensity by linear_from_byte. Parallel over rows.
+    void add(const cv::Mat1b& image, const float* linear_from_byte)
     {
-        const auto ir = readGrayImage(image_path);
-        if (ir_sum.empty())
+        if (count == 0)
         {
-            ir_sum = makeCvMatConstPointer(ir);
+            mean = cv::Mat1d::zeros(image.size());
+            sum_squared_deviations = cv::Mat1d::zeros(image.size());
+            min = cv::Mat1f(image.size(), std::numeric_limits<float>::infinity());
+            max = cv::Mat1f(image.size(), -std::numeric_limits<float>::infinity());
         }
-        else
+        CHECK_EQ(image.size(), mean.size());
+        count += 1;
+        const double weight = 1.0 / static_cast<double>(count);
+        detail::forEachRow(execution::par, static_cast<size_t>(image.rows),
+            static_cast<size_t>(image.cols), [&](size_t y)
         {
-            ir_sum += makeCvMatConstPointer(ir);
-        }
+            const int row = static_cast<int>(y);
+            const uint8_t* bytes = image[row];
+            double* means = mean[row];
+            double* deviations = sum_squared_deviations[row];
+            float* mins = min[row];
+            float* maxs = max[row];
+            for (int col : irange(image.cols))
+            {
+                const float value = linear_from_byte[bytes[col]];
+                const double delta = value - means[col];
+                means[col] += delta * weight;
+                deviations[col] += delta * (value - means[col]);
+                mins[col] = std::min(mins[col], value);
+                maxs[col] = std::max(maxs[col], value);
+            }
+        });
     }
+};
+
+} // namespace
+
+GrayImageStatistics readGrayImageStatistics(const fs::path& directory)
+{
+    const auto image_paths = getFilesInDir(directory, ".png");
+    CHECK_GT(image_paths.size(), 0u);
 
-    Imagef image_float{image::dimensions(ir_sum)};
-    ir_sum.convertTo(makeCvMatPointer(image_float), CV_32F,
-        1.0 / static_cast<double>(image_paths.size()));
-    return image_float;
+    float linear_from_byte[256];
+    for (int i : irange(256))
+    {
+        linear_from_byte[i] = linearFromSrgbByte(static_cast<uint8_t>(i));
+    }
+
+    // The files are read and decoded on the prefetch threads, which block on I/O, while the
+    // accumulation of each image runs on the compute threads.
+    RunningGrayStatistics total;
+    ImagePrefetcher prefetcher(image_paths, cv::IMREAD_GRAYSCALE);
+    while (const auto prefetched = prefetcher.next())
+    {
+        ERROR_CONTEXT("path", prefetched->path.c_str());
+        CHECK_F(!prefetched->image.empty(), "Failed to load image at '%s'",
+            prefetched->path.c_str());
+        total.add(prefetched->image, linear_from_byte);
+    }
+
+    GrayImageStatistics statistics;
+    statistics.count = total.count;
+    total.mean.convertTo(statistics.mean, CV_32F);
+    total.sum_squared_deviations.convertTo(
+        statistics.variance, CV_32F, 1.0 / static_cast<double>(total.count));
+    statistics.min = total.min;
+    statistics.max = total.max;
+    return statistics;
+}
+
+Imagef readAndAverageGrayImages(const fs::path& directory)
+{
+    return shareImage(readGrayImageStatistics(directory).mean);
 }
 
 Imageb readImageMask(const fs::path& file_path)
@@ -170,19 +512,18 @@ cv::Mat1f decodeDepthCvImage(const cv::Mat_<uint16_t>& raw_depth)
 {
     if (raw_depth.empty()) { return {}; }
 
-    cv::Mat_<float> raw_depth_float;
-    raw_depth.convertTo(raw_depth_float, CV_32FC1);
     // The third pixel is maxval when depth is saved in tenths of millimetres (dmm).
-    auto encoded_in_dmm = raw_depth(2) == std::numeric_limits<uint16_t>::max();
+    const bool encoded_in_dmm = raw_depth(2) == std::numeric_limits<uint16_t>::max();
+    const double scale = encoded_in_dmm ? kMetersFrom100Micrometers : kMetersFromMillimeters;
+
+    // Convert and scale in one pass, so that the depth image is the only float allocation.
+    cv::Mat1f depth;
+    raw_depth.convertTo(depth, CV_32FC1, scale);
     if (encoded_in_dmm)
     {
-        raw_depth_float(2) = 0.f;
-        return kMetersFrom100Micrometers * raw_depth_float;
-    }
-    else
-    {
-        return kMetersFromMillimeters * raw_depth_float;
+        depth(2) = 0.f;
     }
+    return depth;
 }
 
 cv::Mat1f readDepthCvImage(const fs::path& path)
@@ -196,17 +537,17 @@ cv::Mat1b readIrCvImage(const fs::path& path)
     return readCvImage(path, cv::IMREAD_GRAYSCALE);
 }
 
-void writeDepthCvImage(const fs::path& path, const cv::Mat1f& mat)
+bool tryWriteDepthCvImage(const fs::path& path, const cv::Mat1f& mat)
 {
     ERROR_CONTEXT("path", path.c_str());
     cv::Mat_<uint16_t> depth_frame_ui16;
     mat.convertTo(depth_frame_ui16, CV_16U, k100MicrometersFromMeters);
     // Set third pixel to maxval to indicate dmm depth format.
     depth_frame_ui16(2) = std::numeric_limits<uint16_t>::max();
-    CHECK(writeCvImage(path, depth_frame_ui16, {cv::IMWRITE_PNG_COMPRESSION, 5}));
+    return writeCvImage(path, depth_frame_ui16, {cv::IMWRITE_PNG_COMPRESSION, 5});
 }
 
-void writeGrayCvImage(const fs::path& path, const cv::Mat& mat)
+bool tryWriteGrayCvImage(const fs::path& path, const cv::Mat& mat)
 {
     CHECK_EQ(mat.channels(), 1);
     cv::Mat1b gray1b;
@@ -219,13 +560,29 @@ void writeGrayCvImage(const fs::path& path, const cv::Mat& mat)
         CHECK(mat.type() == CV_32F || mat.type() == CV_64F);
         gray1b = makeCvMat(cv::Mat1f(mat), srgbByteFromLinear);
     }
-    CHECK(writeCvImage(path, gray1b, {cv::IMWRITE_PNG_COMPRESSION, 5}));
+    return writeCvImage(path, gray1b, {cv::IMWRITE_PNG_COMPRESSION, 5});
 }
 
-void writeColorCvImage(const fs::path& path, const cv::Mat& image)
+bool tryWriteColorCvImage(const fs::path& path, const cv::Mat& image)
 {
     // using compression=75 over compression=90 makes the file a fifth of the size.
-    CHECK(writeCvImage(path, image, {cv::IMWRITE_JPEG_QUALITY, 75}));
+    return writeCvImage(path, image, {cv::IMWRITE_JPEG_QUALITY, 75});
+}
+
+void writeDepthCvImage(const fs::path& path, const cv::Mat1f& mat)
+{
+    ERROR_CONTEXT("path", path.c_str());
+    CHECK(tryWriteDepthCvImage(path, mat));
+}
+
+void writeGrayCvImage(const fs::path& path, const cv::Mat& mat)
+{
+    CHECK(tryWriteGrayCvImage(path, mat));
+}
+
+void writeColorCvImage(const fs::path& path, const cv::Mat& image)
+{
+    CHECK(tryWriteColorCvImage(path, image));
 }
 
 } // namespace komb
@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 
+#include <boost/optional.hpp>
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 
@@ -23,10 +24,43 @@ bool isImageExtension(std::string extension);
  */
 cv::Mat_<uint16_t> readRawDepthPng(const fs::path& file_name);
 
-/// mode is the same as for cv::imread
+/// Decode an encoded image (PNG, JPEG, ...) from memory. mode is the same as for cv::imread.
+/// The EXIF orientation is applied like cv::imread does, whatever the version of OpenCV.
+cv::Mat decodeCvImage(const uint8_t* data, size_t size, int mode = cv::IMREAD_UNCHANGED);
+
+/// mode is the same as for cv::imread.
+/// The file is memory mapped and decoded in place, without reading it into a buffer first.
 cv::Mat readCvImage(const fs::path& path, cv::ImreadModes mode = cv::IMREAD_UNCHANGED);
 cv::Mat readCvImageOrDie(const fs::path& path, cv::ImreadModes mode = cv::IMREAD_UNCHANGED);
 
+/// Width and height of a JPEG or PNG image, read from its header. boost::none for other formats.
+boost::optional<cv::Size> peekImageSize(const uint8_t* data, size_t size);
+
+/// The EXIF orientation of a JPEG image, 1 to 8. 1, i.e. as stored, if it has none.
+int peekExifOrientation(const uint8_t* data, size_t size);
+
+/// The largest of 1, 2, 4 and 8 that divides image_side into no less than min_side.
+int imageReductionFactor(int image_side, int min_side);
+
+/**
+ * Read an image at 1/2, 1/4 or 1/8 resolution, keeping both sides at least min_side.
+ * JPEGs are decoded directly at the reduced scale by libjpeg, which is several times
+ * faster than a full decode. Other formats are decoded in full and then downscaled.
+ * mode is cv::IMREAD_COLOR or cv::IMREAD_GRAYSCALE.
+ */
+cv::Mat readReducedCvImage(
+    const fs::path& path, int min_side, cv::ImreadModes mode = cv::IMREAD_COLOR);
+
+struct FullAndReducedImage
+{
+    cv::Mat full;    ///< Empty if the image could not be read, like readCvImage.
+    cv::Mat reduced; ///< As from readReducedCvImage. Empty if full is.
+};
+
+/// Read an image both in full and as readReducedCvImage, reading and parsing the file once.
+FullAndReducedImage readFullAndReducedCvImage(
+    const fs::path& path, int min_side, cv::ImreadModes mode = cv::IMREAD_COLOR);
+
 cv::Mat3b readCvImageBgrOrDie(const fs::path& path);
 
 /// params is the same as for cv::imwrite
@@ -44,6 +78,22 @@ cv::Mat1f decodeDepthCvImage(const cv::Mat_<uint16_t>& raw_depth);
 /// @brief Reads a depth image in either mm or dmm format and returns the result in m units.
 Imagef readDepthImage(const fs::path& file_path);
 
+/// Per-pixel statistics of the linear intensity of a set of gray images, as from readGrayImage.
+struct GrayImageStatistics
+{
+    cv::Mat1f mean;
+    cv::Mat1f variance; ///< Population variance, i.e. divided by count.
+    cv::Mat1f min;
+    cv::Mat1f max;
+    size_t    count = 0;
+};
+
+/// Read all PNG images in a directory on background threads and compute their statistics in one
+/// pass, in parallel over the rows of each image.
+/// All images must have the same size.
+GrayImageStatistics readGrayImageStatistics(const fs::path& directory);
+
+/// The mean of readGrayImageStatistics.
 Imagef readAndAverageGrayImages(const fs::path& directory);
 
 Imageb readImageMask(const fs::path& file_path);
@@ -60,6 +110,11 @@ void writeDepthCvImage(const fs::path& path, const cv::Mat1f& mat);
 void writeGrayCvImage(const fs::path& path, const cv::Mat& mat);
 void writeColorCvImage(const fs::path& path, const cv::Mat& mat);
 
+/// Same as the above, but return false on failure instead of aborting. See AsyncImageWriter.
+bool tryWriteDepthCvImage(const fs::path& path, const cv::Mat1f& mat);
+bool tryWriteGrayCvImage(const fs::path& path, const cv::Mat& mat);
+bool tryWriteColorCvImage(const fs::path& path, const cv::Mat& mat);
+
 void writeNormalizedGrayImage(const fs::path& path, const Imagef& image);
 void writeNormalizedGrayImage(const fs::path& path, const Imaged& image);
 void writeNormalizedGrayCvImage(const fs::path& path, const cv::Mat1f& mat);
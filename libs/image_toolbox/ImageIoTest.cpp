@@ -0,0 +1,189 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <opencv2/opencv.hpp>
+
+#include <common/ScopeExit.hpp>
+#include <file_io_toolbox/FileIo.hpp>
+#include <image_toolbox/Gamma.hpp>
+#include <image_toolbox/ImageIo.hpp>
+#include <image_toolbox/OpenCvTools.hpp>
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(image_toolbox)
+
+BOOST_AUTO_TEST_CASE(PeekImageSize)
+{
+    const cv::Mat3b image(300, 400, cv::Vec3b(10, 20, 30));
+    for (const char* extension : {".jpg", ".png"})
+    {
+        std::vector<uint8_t> encoded;
+        BOOST_REQUIRE(cv::imencode(extension, image, encoded));
+        const auto size = komb::peekImageSize(encoded.data(), encoded.size());
+        BOOST_REQUIRE(size);
+        BOOST_CHECK_EQUAL(*size, image.size());
+    }
+
+    std::vector<uint8_t> bmp;
+    BOOST_REQUIRE(cv::imencode(".bmp", image, bmp));
+    BOOST_CHECK(!komb::peekImageSize(bmp.data(), bmp.size()));
+}
+
+BOOST_AUTO_TEST_CASE(ImageReductionFactor)
+{
+    BOOST_CHECK_EQUAL(komb::imageReductionFactor(4000, 500), 8);
+    BOOST_CHECK_EQUAL(komb::imageReductionFactor(3991, 500), 4);
+    BOOST_CHECK_EQUAL(komb::imageReductionFactor(1080, 500), 2);
+    BOOST_CHECK_EQUAL(komb::imageReductionFactor(500, 500), 1);
+    BOOST_CHECK_EQUAL(komb::imageReductionFactor(300, 500), 1);
+}
+
+BOOST_AUTO_TEST_CASE(DecodeCvImage)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("image_io_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    cv::Mat1w image(30, 40);
+    cv::randu(image, 0, 65535);
+    std::vector<uint8_t> png;
+    BOOST_REQUIRE(cv::imencode(".png", image, png));
+    const cv::Mat decoded = komb::decodeCvImage(png.data(), png.size());
+    BOOST_REQUIRE_EQUAL(decoded.type(), CV_16UC1);
+    BOOST_CHECK_EQUAL(cv::norm(decoded, image, cv::NORM_INF), 0.0);
+
+    const uint8_t garbage[4] = {1, 2, 3, 4};
+    BOOST_CHECK(komb::decodeCvImage(garbage, sizeof(garbage)).empty());
+    BOOST_CHECK(komb::decodeCvImage(nullptr, 0).empty());
+
+    // Read from the mapped file, and through the cv::imread fallback when it can not be mapped.
+    const fs::path path = temp_dir / "image.png";
+    komb::writeBinaryFile(path, png.data(), png.size());
+    BOOST_CHECK_EQUAL(cv::norm(komb::readCvImage(path), image, cv::NORM_INF), 0.0);
+    komb::writeBinaryFile(temp_dir / "empty.png", nullptr, 0);
+    BOOST_CHECK(komb::readCvImage(temp_dir / "empty.png").empty());
+    BOOST_CHECK(komb::readCvImage(temp_dir).empty());
+    BOOST_CHECK(komb::readCvImage(temp_dir / "missing.png").empty());
+}
+
+BOOST_AUTO_TEST_CASE(DecodeCvImageAppliesExifOrientation)
+{
+    // Black on the left and white on the right, as stored.
+    cv::Mat3b image(20, 40, cv::Vec3b(0, 0, 0));
+    image.colRange(20, 40).setTo(cv::Vec3b(255, 255, 255));
+    std::vector<uint8_t> jpeg;
+    BOOST_REQUIRE(cv::imencode(".jpg", image, jpeg));
+    BOOST_CHECK_EQUAL(komb::peekExifOrientation(jpeg.data(), jpeg.size()), 1);
+
+    // An APP1 segment right after the start of image, with a big-endian TIFF header and one IFD
+    // entry: orientation 6, i.e. rotate 90 degrees clockwise to display.
+    const std::vector<uint8_t> exif{
+        0xFF, 0xE1, 0x00, 0x22, 'E', 'x', 'i', 'f', 0, 0,
+        'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+        0x00, 0x01,
+        0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00,
+    };
+    jpeg.insert(jpeg.begin() + 2, exif.begin(), exif.end());
+    BOOST_CHECK_EQUAL(komb::peekExifOrientation(jpeg.data(), jpeg.size()), 6);
+
+    const cv::Mat3b rotated = komb::decodeCvImage(jpeg.data(), jpeg.size(), cv::IMREAD_COLOR);
+    BOOST_REQUIRE_EQUAL(rotated.size(), cv::Size(20, 40));
+    BOOST_CHECK(rotated(5, 10)[0] < 20);
+    BOOST_CHECK(rotated(35, 10)[0] > 235);
+
+    // Like cv::imread, IMREAD_UNCHANGED and IMREAD_IGNORE_ORIENTATION keep the stored orientation.
+    const int kIgnoreOrientation = cv::IMREAD_COLOR | cv::IMREAD_IGNORE_ORIENTATION;
+    for (const int mode : {static_cast<int>(cv::IMREAD_UNCHANGED), kIgnoreOrientation})
+    {
+        const cv::Mat3b stored = komb::decodeCvImage(jpeg.data(), jpeg.size(), mode);
+        BOOST_CHECK_EQUAL(stored.size(), cv::Size(40, 20));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ReadReducedJpeg)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("image_io_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    const fs::path path = temp_dir / "image.jpg";
+    BOOST_REQUIRE(komb::writeCvImage(path, cv::Mat3b(1200, 1600, cv::Vec3b(50, 100, 150))));
+
+    const cv::Mat reduced = komb::readReducedCvImage(path, 300);
+    BOOST_CHECK_EQUAL(reduced.size(), cv::Size(400, 300));
+    BOOST_CHECK_EQUAL(reduced.type(), CV_8UC3);
+
+    const cv::Mat gray = komb::readReducedCvImage(path, 600, cv::IMREAD_GRAYSCALE);
+    BOOST_CHECK_EQUAL(gray.size(), cv::Size(800, 600));
+    BOOST_CHECK_EQUAL(gray.type(), CV_8UC1);
+}
+
+BOOST_AUTO_TEST_CASE(ReadFullAndReducedImage)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("image_io_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    for (const std::string name : {"image.jpg", "image.png"})
+    {
+        const fs::path path = temp_dir / name;
+        BOOST_REQUIRE(komb::writeCvImage(path, cv::Mat3b(1200, 1600, cv::Vec3b(50, 100, 150))));
+
+        const komb::FullAndReducedImage images = komb::readFullAndReducedCvImage(path, 300);
+        BOOST_CHECK_EQUAL(images.full.size(), cv::Size(1600, 1200));
+        BOOST_CHECK_EQUAL(images.reduced.size(), komb::readReducedCvImage(path, 300).size());
+        BOOST_CHECK_EQUAL(images.reduced.type(), CV_8UC3);
+    }
+
+    const komb::FullAndReducedImage missing =
+        komb::readFullAndReducedCvImage(temp_dir / "missing.jpg", 300);
+    BOOST_CHECK(missing.full.empty());
+    BOOST_CHECK(missing.reduced.empty());
+}
+
+BOOST_AUTO_TEST_CASE(ReadGrayImageStatistics)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("image_io_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    const std::vector<uint8_t> kValues{10, 200, 60, 60, 130};
+    for (size_t i = 0; i < kValues.size(); ++i)
+    {
+        cv::Mat1b image(6, 8, kValues[i]);
+        image(0, 0) = 0;
+        BOOST_REQUIRE(komb::writeCvImage(
+            temp_dir / ("frame_" + std::to_string(i) + ".png"), image));
+    }
+
+    double sum = 0;
+    double sum_squares = 0;
+    for (uint8_t value : kValues)
+    {
+        sum += komb::linearFromSrgbByte(value);
+        sum_squares += komb::linearFromSrgbByte(value) * komb::linearFromSrgbByte(value);
+    }
+    const double mean = sum / kValues.size();
+    const double variance = sum_squares / kValues.size() - mean * mean;
+
+    const komb::GrayImageStatistics statistics = komb::readGrayImageStatistics(temp_dir);
+    BOOST_CHECK_EQUAL(statistics.count, kValues.size());
+    BOOST_REQUIRE_EQUAL(statistics.mean.size(), cv::Size(8, 6));
+    BOOST_CHECK_CLOSE(statistics.mean(3, 4), mean, 1e-3);
+    BOOST_CHECK_CLOSE(statistics.variance(3, 4), variance, 1e-2);
+    BOOST_CHECK_CLOSE(statistics.min(3, 4), komb::linearFromSrgbByte(10), 1e-4);
+    BOOST_CHECK_CLOSE(statistics.max(3, 4), komb::linearFromSrgbByte(200), 1e-4);
+    BOOST_CHECK_SMALL(statistics.mean(0, 0), 1e-6f);
+    BOOST_CHECK_SMALL(statistics.variance(0, 0), 1e-6f);
+
+    const komb::Imagef average = komb::readAndAverageGrayImages(temp_dir);
+    BOOST_CHECK_CLOSE(komb::makeCvMatConstPointer(average)(3, 4), mean, 1e-3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
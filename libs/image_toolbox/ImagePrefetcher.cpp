@@ -0,0 +1,131 @@
+#include "ImagePrefetcher.hpp"
+
+#include <utility>
+
+#include <common/Logging.hpp>
+#include <common/Profiler.hpp>
+
+#include "ImageIo.hpp"
+
+namespace komb {
+
+ImagePrefetcher::ImagePrefetcher(std::vector<fs::path> paths, cv::ImreadModes mode,
+    size_t num_threads, size_t max_buffered)
+    : ImagePrefetcher(std::move(paths),
+        [mode](const fs::path& path) { return readCvImage(path, mode); },
+        num_threads, max_buffered)
+{
+}
+
+ImagePrefetcher::ImagePrefetcher(std::vector<fs::path> paths, ReadImageFunction read_image,
+    size_t num_threads, size_t max_buffered)
+    : paths_(std::move(paths))
+    , read_images_([read_image](const fs::path& path)
+    {
+        return FullAndReducedImage{read_image(path), cv::Mat()};
+    })
+    , max_buffered_(max_buffered)
+{
+    startWorkers(num_threads);
+}
+
+ImagePrefetcher::ImagePrefetcher(std::vector<fs::path> paths, cv::ImreadModes mode,
+    int reduced_min_side, size_t num_threads, size_t max_buffered)
+    : paths_(std::move(paths))
+    , read_images_([mode, reduced_min_side](const fs::path& path)
+    {
+        return readFullAndReducedCvImage(path, reduced_min_side, mode);
+    })
+    , max_buffered_(max_buffered)
+{
+    startWorkers(num_threads);
+}
+
+ImagePrefetcher::~ImagePrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void ImagePrefetcher::startWorkers(size_t num_threads)
+{
+    CHECK_GT(num_threads, 0u);
+    CHECK_GT(max_buffered_, 0u);
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        workers_.emplace_back(&ImagePrefetcher::workerLoop, this);
+    }
+}
+
+boost::optional<PrefetchedImage> ImagePrefetcher::next()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (next_to_return_ == paths_.size())
+    {
+        return boost::none;
+    }
+
+    const size_t index = next_to_return_;
+    condition_.wait(lock, [&]() { return decoded_.count(index) != 0; });
+    Decoded decoded = std::move(decoded_[index]);
+    decoded_.erase(index);
+    ++next_to_return_;
+    lock.unlock();
+
+    // A slot is free, so one worker can start on the next image.
+    condition_.notify_all();
+    if (decoded.error)
+    {
+        std::rethrow_exception(decoded.error);
+    }
+    return PrefetchedImage{index, paths_[index],
+        std::move(decoded.images.full), std::move(decoded.images.reduced)};
+}
+
+void ImagePrefetcher::workerLoop()
+{
+    setThreadName("prefetch");
+
+    // Workers that run out of images wait here until the prefetcher is destroyed.
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+        condition_.wait(lock, [&]()
+        {
+            return stop_ || (next_to_read_ < paths_.size() &&
+                next_to_read_ < next_to_return_ + max_buffered_);
+        });
+        if (stop_)
+        {
+            return;
+        }
+
+        const size_t index = next_to_read_++;
+        lock.unlock();
+
+        // Thrown errors are handed to next(), which would otherwise wait for the image forever.
+        Decoded decoded;
+        try
+        {
+            PROFILE_STAGE(prefetchImage);
+            decoded.images = read_images_(paths_[index]);
+        }
+        catch (...)
+        {
+            decoded.error = std::current_exception();
+        }
+
+        lock.lock();
+        decoded_[index] = std::move(decoded);
+        condition_.notify_all();
+    }
+}
+
+} // namespace komb
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/optional.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <common/Path.hpp>
+
+#include "ImageIo.hpp"
+
+namespace komb {
+
+struct PrefetchedImage
+{
+    size_t   index;   ///< Index into the path list.
+    fs::path path;
+    cv::Mat  image;   ///< Empty if the image could not be read, like readCvImage.
+    cv::Mat  reduced; ///< Empty unless the prefetcher was given a reduced_min_side.
+};
+
+/**
+ * @brief Reads and decodes images ahead of time on background threads.
+ *
+ * Images are handed out in the order of the path list, while the worker threads keep decoding
+ * the next ones. At most max_buffered images are decoded or being decoded but not handed out,
+ * which bounds the memory use.
+ */
+class ImagePrefetcher
+{
+public:
+    using ReadImageFunction = std::function<cv::Mat(const fs::path&)>;
+
+    /// Read with readCvImage.
+    ImagePrefetcher(std::vector<fs::path> paths, cv::ImreadModes mode = cv::IMREAD_COLOR,
+        size_t num_threads = 2, size_t max_buffered = 4);
+
+    /// Read with a custom function, like readReducedCvImage. Called from the worker threads.
+    ImagePrefetcher(std::vector<fs::path> paths, ReadImageFunction read_image,
+        size_t num_threads = 2, size_t max_buffered = 4);
+
+    /// Read with readFullAndReducedCvImage, so that each file is read once for both images.
+    ImagePrefetcher(std::vector<fs::path> paths, cv::ImreadModes mode, int reduced_min_side,
+        size_t num_threads, size_t max_buffered);
+
+    /// Stops the workers without waiting for the remaining images.
+    ~ImagePrefetcher();
+
+    ImagePrefetcher(const ImagePrefetcher&) = delete;
+    ImagePrefetcher& operator=(const ImagePrefetcher&) = delete;
+
+    /// Blocks until the next image is decoded. Returns boost::none after the last image.
+    /// Rethrows what the read function threw for the image, if anything.
+    boost::optional<PrefetchedImage> next();
+
+    size_t size() const { return paths_.size(); }
+
+private:
+    using ReadImagesFunction = std::function<FullAndReducedImage(const fs::path&)>;
+
+    /// A finished image, or why it could not be read.
+    struct Decoded
+    {
+        FullAndReducedImage images;
+        std::exception_ptr  error;
+    };
+
+    void startWorkers(size_t num_threads);
+    void workerLoop();
+
+    const std::vector<fs::path> paths_;
+    const ReadImagesFunction    read_images_;
+    const size_t                max_buffered_;
+
+    std::mutex                mutex_;
+    std::condition_variable   condition_;
+    size_t                    next_to_read_ = 0;   ///< Next index a worker will claim.
+    size_t                    next_to_return_ = 0; ///< Next index next() will return.
+    std::map<size_t, Decoded> decoded_;            ///< Finished images not yet handed out.
+    bool                      stop_ = false;
+    std::vector<std::thread>  workers_;
+};
+
+} // namespace komb
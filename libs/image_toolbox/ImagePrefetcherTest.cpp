@@ -0,0 +1,103 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+#include <opencv2/core.hpp>
+
+#include <common/ScopeExit.hpp>
+#include <image_toolbox/ImageIo.hpp>
+#include <image_toolbox/ImagePrefetcher.hpp>
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(image_toolbox)
+
+BOOST_AUTO_TEST_CASE(ImagePrefetcherReturnsImagesInOrder)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("prefetch_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    const int kNumImages = 10;
+    std::vector<fs::path> paths;
+    for (int i = 0; i < kNumImages; ++i)
+    {
+        paths.push_back(temp_dir / ("image_" + std::to_string(i) + ".png"));
+        BOOST_REQUIRE(komb::writeCvImage(paths.back(), cv::Mat1b(8, 8, static_cast<uint8_t>(i))));
+    }
+    paths.push_back(temp_dir / "missing.png");
+
+    komb::ImagePrefetcher prefetcher(paths, cv::IMREAD_GRAYSCALE, 3, 2);
+    BOOST_CHECK_EQUAL(prefetcher.size(), paths.size());
+    for (int i = 0; i < kNumImages; ++i)
+    {
+        const auto image = prefetcher.next();
+        BOOST_REQUIRE(image);
+        BOOST_CHECK_EQUAL(image->index, static_cast<size_t>(i));
+        BOOST_CHECK(image->path == paths[static_cast<size_t>(i)]);
+        BOOST_REQUIRE_EQUAL(image->image.type(), CV_8UC1);
+        BOOST_CHECK_EQUAL(static_cast<int>(image->image.at<uint8_t>(0, 0)), i);
+    }
+
+    const auto missing = prefetcher.next();
+    BOOST_REQUIRE(missing);
+    BOOST_CHECK(missing->image.empty());
+    BOOST_CHECK(!prefetcher.next());
+}
+
+BOOST_AUTO_TEST_CASE(ImagePrefetcherReadsFullAndReduced)
+{
+    const fs::path temp_dir = fs::temp_directory_path() / fs::unique_path("prefetch_%%%%%%%%");
+    fs::create_directories(temp_dir);
+    SCOPE_EXIT{ fs::remove_all(temp_dir); };
+
+    const fs::path path = temp_dir / "image.jpg";
+    BOOST_REQUIRE(komb::writeCvImage(path, cv::Mat3b(400, 800, cv::Vec3b(50, 100, 150))));
+
+    komb::ImagePrefetcher prefetcher({path, temp_dir / "missing.jpg"}, cv::IMREAD_COLOR, 100, 2, 2);
+    const auto image = prefetcher.next();
+    BOOST_REQUIRE(image);
+    BOOST_CHECK_EQUAL(image->image.size(), cv::Size(800, 400));
+    BOOST_CHECK_EQUAL(image->reduced.size(), cv::Size(200, 100));
+
+    const auto missing = prefetcher.next();
+    BOOST_REQUIRE(missing);
+    BOOST_CHECK(missing->image.empty() && missing->reduced.empty());
+    BOOST_CHECK(!prefetcher.next());
+}
+
+BOOST_AUTO_TEST_CASE(ImagePrefetcherRethrowsReadErrors)
+{
+    const std::vector<fs::path> paths{"0.png", "throw.png", "2.png"};
+    komb::ImagePrefetcher prefetcher(paths, [](const fs::path& path)
+    {
+        if (path == "throw.png")
+        {
+            throw std::runtime_error("Corrupt image");
+        }
+        return cv::Mat(cv::Mat1b(2, 2, uint8_t(0)));
+    }, 2, 2);
+
+    BOOST_CHECK(prefetcher.next());
+    BOOST_CHECK_THROW(prefetcher.next(), std::runtime_error);
+
+    // The images after it are still handed out.
+    const auto image = prefetcher.next();
+    BOOST_REQUIRE(image);
+    BOOST_CHECK_EQUAL(image->index, 2u);
+    BOOST_CHECK(!prefetcher.next());
+}
+
+BOOST_AUTO_TEST_CASE(ImagePrefetcherStopsEarly)
+{
+    // Destroying the prefetcher before all images are handed out must not hang.
+    komb::ImagePrefetcher prefetcher(
+        std::vector<fs::path>(20, "does_not_exist.png"), cv::IMREAD_COLOR, 2, 1);
+    BOOST_CHECK(prefetcher.next());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
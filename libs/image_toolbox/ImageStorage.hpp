@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <common/MemoryResource.hpp>
+
+namespace komb {
+
+/// Tag for constructors that leave the pixels default initialized, i.e. garbage for plain types.
+struct Uninitialized {};
+constexpr Uninitialized kUninitialized{};
+
+/**
+ * @brief Pixel memory of a komb::Image: contiguous, 64 byte aligned, and allocated from a
+ * MemoryResource.
+ *
+ * The allocation is padded to a whole number of kAlignment blocks, so SIMD loops may load and
+ * store full vectors past the last pixel, up to capacity(). The padding is never initialized.
+ *
+ * A storage can also use memory owned by someone else: either a non-owning view, or shared
+ * through a reference counted owner, e.g. a cv::Mat. These have no padding and the alignment
+ * of the owner. Copies are always owning deep copies, allocated from defaultMemoryResource().
+ */
+template<typename T>
+class ImageStorage
+{
+public:
+    static constexpr size_t kAlignment = 64;
+
+    ImageStorage() = default;
+
+    /// Allocates but does not construct the elements. The caller must construct all of them.
+    ImageStorage(size_t size, MemoryResource& resource)
+        : size_(size)
+        , capacity_(paddedCapacity(size))
+        , resource_(&resource)
+    {
+        if (capacity_ != 0)
+        {
+            data_ = static_cast<T*>(resource.allocate(capacity_ * sizeof(T), allocAlignment()));
+        }
+    }
+
+    ImageStorage(const ImageStorage& other)
+        : ImageStorage(other.size_, defaultMemoryResource())
+    {
+        std::uninitialized_copy_n(other.data_, size_, data_);
+    }
+
+    ImageStorage(ImageStorage&& other) noexcept
+    {
+        swap(other);
+    }
+
+    ImageStorage& operator=(const ImageStorage& other)
+    {
+        if (this != &other)
+        {
+            ImageStorage copy(other);
+            swap(copy);
+        }
+        return *this;
+    }
+
+    ImageStorage& operator=(ImageStorage&& other) noexcept
+    {
+        ImageStorage moved(std::move(other));
+        swap(moved);
+        return *this;
+    }
+
+    ~ImageStorage()
+    {
+        if (resource_ == nullptr || data_ == nullptr) // A view or shared.
+        {
+            return;
+        }
+        if (!std::is_trivially_destructible<T>::value)
+        {
+            for (size_t i = 0; i < size_; ++i)
+            {
+                data_[i].~T();
+            }
+        }
+        resource_->deallocate(data_, capacity_ * sizeof(T), allocAlignment());
+    }
+
+    /// Non-owning, data must outlive the storage.
+    static ImageStorage view(T* data, size_t size)
+    {
+        ImageStorage storage;
+        storage.data_ = data;
+        storage.size_ = size;
+        storage.capacity_ = size;
+        return storage;
+    }
+
+    /// Keeps owner alive for as long as the storage, or any storage moved from it, lives.
+    static ImageStorage shared(T* data, size_t size, std::shared_ptr<const void> owner)
+    {
+        ImageStorage storage = view(data, size);
+        storage.owner_ = std::move(owner);
+        return storage;
+    }
+
+    T*     data()      const { return data_; }
+    size_t size()      const { return size_; }
+    size_t capacity()  const { return capacity_; }
+    bool   ownsData()  const { return resource_ != nullptr || owner_ != nullptr; }
+
+    void swap(ImageStorage& other) noexcept
+    {
+        std::swap(data_,     other.data_);
+        std::swap(size_,     other.size_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(resource_, other.resource_);
+        std::swap(owner_,    other.owner_);
+    }
+
+private:
+    static size_t paddedCapacity(size_t size)
+    {
+        const size_t bytes = size * sizeof(T);
+        const size_t padded_bytes = (bytes + kAlignment - 1) / kAlignment * kAlignment;
+        return (padded_bytes + sizeof(T) - 1) / sizeof(T);
+    }
+
+    static size_t allocAlignment() { return std::max(kAlignment, alignof(T)); }
+
+    T*                          data_     = nullptr;
+    size_t                      size_     = 0;
+    size_t                      capacity_ = 0;
+    MemoryResource*             resource_ = nullptr; ///< nullptr for views and shared storage.
+    std::shared_ptr<const void> owner_;              ///< Only set for shared storage.
+};
+
+} // namespace komb
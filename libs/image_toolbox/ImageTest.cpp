@@ -0,0 +1,91 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <opencv2/core.hpp>
+
+#include <common/MemoryResource.hpp>
+#include <image_toolbox/Image.hpp>
+#include <image_toolbox/OpenCvTools.hpp>
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(image_toolbox)
+
+BOOST_AUTO_TEST_CASE(ImageStorageIsAlignedAndPadded)
+{
+    const komb::Image<uint8_t> image(13, 3, uint8_t(7));
+    BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(image.data()) % 64, 0u);
+    BOOST_CHECK_EQUAL(image.size(), 39u);
+    BOOST_CHECK_EQUAL(image.capacity(), 64u);
+    BOOST_CHECK(image.ownsData());
+    BOOST_CHECK_EQUAL(image(12, 2), 7);
+
+    const komb::Imagef zeros(5, 5);
+    BOOST_CHECK_EQUAL(zeros(4, 4), 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(ImageViewAndCopy)
+{
+    std::vector<float> pixels{1, 2, 3, 4, 5, 6};
+    komb::Imagef view = komb::Imagef::view(pixels.data(), 3, 2);
+    BOOST_CHECK(!view.ownsData());
+    BOOST_CHECK_EQUAL(view.data(), pixels.data());
+    view(2, 1) = 60;
+    BOOST_CHECK_EQUAL(pixels[5], 60.0f);
+
+    komb::Imagef copy = view;
+    BOOST_CHECK(copy.ownsData());
+    BOOST_CHECK(copy.data() != pixels.data());
+    copy(0, 0) = 10;
+    BOOST_CHECK_EQUAL(pixels[0], 1.0f);
+    BOOST_CHECK_EQUAL(copy(2, 1), 60.0f);
+
+    komb::Imagef moved = std::move(copy);
+    BOOST_CHECK_EQUAL(moved(0, 0), 10.0f);
+    BOOST_CHECK(copy.empty());
+}
+
+BOOST_AUTO_TEST_CASE(ImageFromPool)
+{
+    komb::PoolMemoryResource pool(1 << 20);
+    const float* first_pixels = nullptr;
+    {
+        komb::Imagef image(100, 100, komb::kUninitialized, pool);
+        first_pixels = image.data();
+    }
+    BOOST_CHECK(pool.cachedBytes() > 0u);
+
+    // Same size, so the freed block is reused.
+    const komb::Imagef image(100, 100, komb::kUninitialized, pool);
+    BOOST_CHECK_EQUAL(image.data(), first_pixels);
+    BOOST_CHECK_EQUAL(pool.cachedBytes(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(ShareImageAndCvMatWithoutCopying)
+{
+    cv::Mat1f mat(3, 4, 1.0f);
+    const float* mat_pixels = mat.ptr<float>();
+    komb::Imagef from_mat = komb::shareImage(mat);
+    BOOST_CHECK_EQUAL(from_mat.data(), mat_pixels);
+    BOOST_CHECK_EQUAL(from_mat.width(), 4u);
+    mat.release();
+    BOOST_CHECK_EQUAL(from_mat(3, 2), 1.0f); // Still alive.
+
+    komb::Imagef image(4, 3, 2.0f);
+    const float* image_pixels = image.data();
+    cv::Mat1f to_mat = komb::shareCvMat(std::move(image));
+    BOOST_CHECK_EQUAL(to_mat.ptr<float>(), image_pixels);
+    BOOST_CHECK_EQUAL(to_mat.size(), cv::Size(4, 3));
+    const cv::Mat1f copy = to_mat;
+    to_mat.release();
+    BOOST_CHECK_EQUAL(copy(2, 3), 2.0f); // Still alive.
+
+    const komb::Imagef round_trip = komb::shareImage(copy);
+    BOOST_CHECK_EQUAL(round_trip.data(), image_pixels);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,12 +1,18 @@
 #define BOOST_TEST_DYN_LINK
 
+#include <array>
 #include <cmath>
+#include <cstdint>
+#include <vector>
 
 #include <boost/test/floating_point_comparison.hpp>
 #include <boost/test/unit_test.hpp>
 #include <opencv2/opencv.hpp>
 
+#include <image_toolbox/Convert.hpp>
 #include <image_toolbox/Gamma.hpp>
+#include <image_toolbox/Lut.hpp>
+#include <image_toolbox/Visualization.hpp>
 
 static float kIsSmallTolerance = 0.00001f;
 static double kPercentTolerance = 0.00001;
@@ -46,5 +52,150 @@ BOOST_AUTO_TEST_CASE(GammaTestFloat)
     BOOST_CHECK_CLOSE(img_encoded(0, 0), kEncodedHalf, kPercentTolerance);
 }
 
+BOOST_AUTO_TEST_CASE(CmykRoundTrip)
+{
+    // Large enough to be split between threads, with an odd width for the vector tails.
+    cv::Mat3b img(257, 131);
+    cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(256));
+    img(0, 0) = cv::Vec3b(0, 0, 0);
+    img(0, 1) = cv::Vec3b(255, 255, 255);
+    img(0, 2) = cv::Vec3b(0, 0, 255);
+
+    const std::vector<cv::Mat1b> cmyk = komb::rgb2Cmyk(img);
+    BOOST_REQUIRE_EQUAL(cmyk.size(), 4u);
+    BOOST_CHECK(cv::Vec4b(cmyk[0](0, 0), cmyk[1](0, 0), cmyk[2](0, 0), cmyk[3](0, 0)) ==
+        cv::Vec4b(0, 0, 0, 255));
+    BOOST_CHECK(cv::Vec4b(cmyk[0](0, 1), cmyk[1](0, 1), cmyk[2](0, 1), cmyk[3](0, 1)) ==
+        cv::Vec4b(0, 0, 0, 0));
+    BOOST_CHECK(cv::Vec4b(cmyk[0](0, 2), cmyk[1](0, 2), cmyk[2](0, 2), cmyk[3](0, 2)) ==
+        cv::Vec4b(0, 255, 255, 0));
+
+    // The rounding errors of the two directions cancel for all 8-bit colors.
+    BOOST_CHECK_EQUAL(cv::norm(komb::cmyk2Rgb(cmyk), img, cv::NORM_INF), 0.0);
+}
+
+BOOST_AUTO_TEST_CASE(ChannelConversionsMatchSplit)
+{
+    cv::Mat4b bgra(91, 67);
+    cv::randu(bgra, cv::Scalar::all(0), cv::Scalar::all(256));
+    std::vector<cv::Mat1b> channels;
+    cv::split(bgra, channels);
+
+    cv::Mat3b expected_bgr;
+    cv::merge(std::vector<cv::Mat1b>(channels.begin(), channels.begin() + 3), expected_bgr);
+    const cv::Mat3b bgr = komb::ignoreAlpha(bgra);
+    BOOST_CHECK_EQUAL(cv::norm(bgr, expected_bgr, cv::NORM_INF), 0.0);
+
+    const std::vector<cv::Mat1f> planes = komb::bgrToPlanarFloat(bgr, 0.5f);
+    BOOST_REQUIRE_EQUAL(planes.size(), 3u);
+    for (int i = 0; i < 3; ++i)
+    {
+        cv::Mat1f expected_plane;
+        channels[i].convertTo(expected_plane, CV_32F, 0.5);
+        BOOST_CHECK_EQUAL(cv::norm(planes[i], expected_plane, cv::NORM_INF), 0.0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(FusedDepthShadingMatchesSeparateSteps)
+{
+    // A tilted plane with a bump and a hole, in meters.
+    cv::Mat1f depth(123, 301);
+    for (int y = 0; y < depth.rows; ++y)
+    {
+        for (int x = 0; x < depth.cols; ++x)
+        {
+            const float r2 = static_cast<float>((x - 150) * (x - 150) + (y - 60) * (y - 60));
+            depth(y, x) = 0.4f + 0.001f * x - 0.1f * std::exp(-r2 / 800.0f);
+        }
+    }
+    depth(cv::Rect(20, 30, 15, 10)).setTo(0);
+
+    for (const auto normalize : {komb::Normalize::kYes, komb::Normalize::kNo})
+    {
+        cv::Mat1f shaded = komb::shadeDepthImage(depth);
+        cv::Mat multi_channel_shaded;
+        cv::merge(std::vector<cv::Mat>({shaded, shaded, shaded}), multi_channel_shaded);
+        cv::Mat expected;
+        cv::multiply(0.2f + multi_channel_shaded * 0.8f,
+            komb::colorizeDepthImage(depth, normalize), expected);
+
+        const cv::Mat3f fused = komb::colorizeAndShadeDepthImage(depth, normalize);
+        BOOST_REQUIRE_EQUAL(fused.size(), depth.size());
+        // The gamma is interpolated from a table, and an inverse depth exactly between two bins
+        // may round differently.
+        BOOST_CHECK(cv::norm(fused, expected, cv::NORM_L1) / (3 * fused.total()) < 5e-3);
+        BOOST_CHECK_EQUAL(cv::norm(fused(cv::Rect(20, 30, 15, 10)), cv::NORM_INF), 0.0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LookupTables)
+{
+    cv::Mat_<uint16_t> indices(97, 61);
+    cv::randu(indices, 0, 65536);
+    std::vector<cv::Vec3b> colors(komb::lutSize<uint16_t>());
+    for (size_t i = 0; i < colors.size(); ++i)
+    {
+        colors[i] = cv::Vec3b(i & 0xFF, i >> 8, (i * 7) & 0xFF);
+    }
+    const cv::Mat3b colored = komb::applyLut(indices, colors);
+
+    cv::Mat3b bgr(97, 61);
+    cv::randu(bgr, cv::Scalar::all(0), cv::Scalar::all(256));
+    std::array<std::vector<uint8_t>, 3> luts;
+    for (int c = 0; c < 3; ++c)
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            luts[c].push_back(static_cast<uint8_t>(255 - i + c));
+        }
+    }
+    const cv::Mat3b mapped = komb::applyLutPerChannel(bgr, luts);
+
+    for (int y = 0; y < indices.rows; ++y)
+    {
+        for (int x = 0; x < indices.cols; ++x)
+        {
+            BOOST_REQUIRE(colored(y, x) == colors[indices(y, x)]);
+            for (int c = 0; c < 3; ++c)
+            {
+                BOOST_REQUIRE_EQUAL(mapped(y, x)[c], luts[c][bgr(y, x)[c]]);
+            }
+        }
+    }
+
+    // White stays white, which used to read past the end of the gamma table.
+    const cv::Mat3b gray(2, 2, cv::Vec3b(0, 64, 255));
+    const cv::Mat3b brighter = komb::applyGamma(gray, 2.2f);
+    BOOST_CHECK(brighter(1, 1) == cv::Vec3b(0, 136, 255));
+}
+
+BOOST_AUTO_TEST_CASE(ColormapMatchesInterpolation)
+{
+    const std::vector<cv::Scalar> colors{{0, 0, 255}, {200, 100, 0}, {10, 250, 30}};
+
+    // Interpolated per pixel, through a table with one entry per pixel, and through a full table.
+    for (const cv::Size size : {cv::Size(77, 31), cv::Size(77, 61), cv::Size(301, 300)})
+    {
+        cv::Mat1f values(size);
+        cv::randu(values, -0.5f, 2.5f);
+        const cv::Mat3b colored = komb::applyColormap(values, colors, 0.0f, 2.0f);
+
+        for (int y = 0; y < values.rows; ++y)
+        {
+            for (int x = 0; x < values.cols; ++x)
+            {
+                const double t = std::min(std::max(values(y, x) / 2.0, 0.0), 1.0) * 2;
+                const size_t a = static_cast<size_t>(std::floor(t));
+                const size_t b = static_cast<size_t>(std::ceil(t));
+                const cv::Scalar expected = colors[a] + (colors[b] - colors[a]) * (t - a);
+                for (int c = 0; c < 3; ++c)
+                {
+                    BOOST_REQUIRE(std::abs(colored(y, x)[c] - expected[c]) <= 1.0);
+                }
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,74 @@
+#include "LazyGradientField.hpp"
+
+#include <common/Logging.hpp>
+
+#include "Contour.hpp"
+#include "Magnitude.hpp"
+
+namespace komb {
+
+LazyGradientField::LazyGradientField(
+    const cv::Mat1b& image, int kernel_size, size_t max_cached_tiles)
+    : image_(image)
+    , kernel_size_(kernel_size)
+    , max_cached_tiles_(max_cached_tiles)
+{
+    CHECK(!image.empty());
+    CHECK_GT(max_cached_tiles, 0u);
+}
+
+size_t LazyGradientField::numComputedTiles() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_computed_tiles_;
+}
+
+std::shared_ptr<const LazyGradientField::Tile> LazyGradientField::tile(
+    int tile_x, int tile_y) const
+{
+    const TileKey key = (static_cast<TileKey>(tile_y) << 32) | static_cast<uint32_t>(tile_x);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(key);
+        if (it != cache_.end())
+        {
+            lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+            return it->second.tile;
+        }
+    }
+
+    // Compute without holding the lock. If another thread raced us here, keep its tile.
+    std::shared_ptr<const Tile> new_tile = computeTile(tile_x, tile_y);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_computed_tiles_ += 1;
+    auto it = cache_.find(key);
+    if (it != cache_.end())
+    {
+        return it->second.tile;
+    }
+    lru_.push_front(key);
+    cache_[key] = CacheEntry{new_tile, lru_.begin()};
+    if (cache_.size() > max_cached_tiles_)
+    {
+        cache_.erase(lru_.back()); // Samplers still holding the tile keep it alive.
+        lru_.pop_back();
+    }
+    return new_tile;
+}
+
+std::shared_ptr<const LazyGradientField::Tile> LazyGradientField::computeTile(
+    int tile_x, int tile_y) const
+{
+    const cv::Rect tile_rect =
+        cv::Rect(tile_x * kTileSize, tile_y * kTileSize, kTileSize, kTileSize) &
+        cv::Rect(0, 0, image_.cols, image_.rows);
+    CHECK(!tile_rect.empty());
+
+    auto tile = std::make_shared<Tile>();
+    computeGradient(image_(tile_rect), kernel_size_, tile->dx, tile->dy);
+    tile->gradient_magnitude = magnitude({tile->dx, tile->dy});
+    return tile;
+}
+
+} // namespace komb
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+#include <opencv2/core.hpp>
+
+namespace komb {
+
+/**
+ * @brief Gradient field for refineContourPointsSubpix that computes gradients on demand.
+ *
+ * The image is divided into square tiles. The Sobel derivatives and gradient magnitude of a
+ * tile are computed the first time a sampler touches it and are kept in a small LRU cache.
+ * The Sobel filter reads pixels outside the tile from the parent image, so the values are
+ * identical to those of makeSubpixelRefiner on the full image.
+ *
+ * Thread safe: samplers can be used from different threads at the same time.
+ */
+class LazyGradientField
+{
+public:
+    static const int  kTileSize = 64;
+    static const bool kStatelessSampler = false;
+
+    /// image must outlive the field.
+    LazyGradientField(const cv::Mat1b& image, int kernel_size, size_t max_cached_tiles = 64);
+
+    int cols() const { return image_.cols; }
+    int rows() const { return image_.rows; }
+
+    /// Number of tiles computed so far, including ones that have been evicted.
+    size_t numComputedTiles() const;
+
+    struct Tile
+    {
+        cv::Mat1f dx;
+        cv::Mat1f dy;
+        cv::Mat1f gradient_magnitude;
+    };
+
+    /// Remembers the last two tiles it used, which are usually the next ones needed too,
+    /// also when a search window straddles a tile border.
+    class Sampler
+    {
+    public:
+        explicit Sampler(const LazyGradientField& field) : field_(field) {}
+
+        float dx(int x, int y) { return tileFor(x, y).dx(y % kTileSize, x % kTileSize); }
+        float dy(int x, int y) { return tileFor(x, y).dy(y % kTileSize, x % kTileSize); }
+        float magnitude(int x, int y)
+        {
+            return tileFor(x, y).gradient_magnitude(y % kTileSize, x % kTileSize);
+        }
+
+    private:
+        struct RecentTile
+        {
+            std::shared_ptr<const Tile> tile;
+            int                         tile_x = -1;
+            int                         tile_y = -1;
+        };
+
+        const Tile& tileFor(int x, int y)
+        {
+            const int tile_x = x / kTileSize;
+            const int tile_y = y / kTileSize;
+            if (recent_[0].tile_x != tile_x || recent_[0].tile_y != tile_y)
+            {
+                std::swap(recent_[0], recent_[1]);
+                if (recent_[0].tile_x != tile_x || recent_[0].tile_y != tile_y)
+                {
+                    recent_[0].tile = field_.tile(tile_x, tile_y);
+                    recent_[0].tile_x = tile_x;
+                    recent_[0].tile_y = tile_y;
+                }
+            }
+            return *recent_[0].tile;
+        }
+
+        const LazyGradientField& field_;
+        RecentTile               recent_[2]; ///< Most recently used first.
+    };
+
+    Sampler sampler() const { return Sampler(*this); }
+
+private:
+    std::shared_ptr<const Tile> tile(int tile_x, int tile_y) const;
+    std::shared_ptr<const Tile> computeTile(int tile_x, int tile_y) const;
+
+    using TileKey = uint64_t;
+    using LruList = std::list<TileKey>;
+
+    struct CacheEntry
+    {
+        std::shared_ptr<const Tile> tile;
+        LruList::iterator           lru_position;
+    };
+
+    const cv::Mat1b& image_;
+    int              kernel_size_;
+    size_t           max_cached_tiles_;
+
+    mutable std::mutex                              mutex_;
+    mutable LruList                                 lru_; ///< Most recently used first.
+    mutable std::unordered_map<TileKey, CacheEntry> cache_;
+    mutable size_t                                  num_computed_tiles_ = 0;
+};
+
+} // namespace komb
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include <common/algorithm/ExecutionPolicy.hpp>
+#include <common/Logging.hpp>
+
+namespace komb {
+
+/**
+ * Lookup tables indexed by 8 or 16 bit pixels, applied to whole images row by row in parallel.
+ *
+ *     std::vector<cv::Vec3b> colors(lutSize<uint16_t>());
+ *     ...
+ *     cv::Mat3b colored = applyLut(depth_mm, colors);
+ */
+
+/// The number of entries of a table indexed by T: 256 for uint8_t and 65536 for uint16_t.
+template<typename T>
+constexpr size_t lutSize()
+{
+    static_assert(std::is_same<T, uint8_t>::value || std::is_same<T, uint16_t>::value,
+        "Lookup tables are indexed by 8 or 16 bit values");
+    return size_t(1) << (8 * sizeof(T));
+}
+
+namespace detail {
+
+/// out[i] = lut[in[i]] for i in [0, n).
+template<typename In, typename Out>
+void applyLutRow(const In* in, size_t n, const Out* lut, Out* out)
+{
+    // Unrolled, so that the independent loads of the table overlap.
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const Out a = lut[in[i + 0]];
+        const Out b = lut[in[i + 1]];
+        const Out c = lut[in[i + 2]];
+        const Out d = lut[in[i + 3]];
+        out[i + 0] = a;
+        out[i + 1] = b;
+        out[i + 2] = c;
+        out[i + 3] = d;
+    }
+    for (; i < n; ++i)
+    {
+        out[i] = lut[in[i]];
+    }
+}
+
+/// Look up channel c of each of n interleaved 3-channel pixels in luts[c].
+template<typename T>
+void applyLutRowPerChannel(const T* in, size_t n, const T* const luts[3], T* out)
+{
+    const T* lut_0 = luts[0];
+    const T* lut_1 = luts[1];
+    const T* lut_2 = luts[2];
+    for (size_t i = 0; i < 3 * n; i += 3)
+    {
+        const T a = lut_0[in[i + 0]];
+        const T b = lut_1[in[i + 1]];
+        const T c = lut_2[in[i + 2]];
+        out[i + 0] = a;
+        out[i + 1] = b;
+        out[i + 2] = c;
+    }
+}
+
+} // namespace detail
+
+/// Map each pixel of a one channel image through lut, e.g. to a color.
+/// lut must have lutSize<In>() entries.
+template<typename In, typename Out>
+cv::Mat_<Out> applyLut(const cv::Mat_<In>& image, const std::vector<Out>& lut)
+{
+    CHECK_EQ(lut.size(), lutSize<In>());
+    cv::Mat_<Out> out(image.size());
+    detail::forEachRow(execution::par, static_cast<size_t>(image.rows),
+        static_cast<size_t>(image.cols), [&](size_t y)
+    {
+        const int row = static_cast<int>(y);
+        detail::applyLutRow(image[row], static_cast<size_t>(image.cols), lut.data(), out[row]);
+    });
+    return out;
+}
+
+namespace detail {
+
+template<typename T>
+cv::Mat_<cv::Vec<T, 3>> applyLutPerChannel(
+    const cv::Mat_<cv::Vec<T, 3>>& image, const T* const luts[3])
+{
+    cv::Mat_<cv::Vec<T, 3>> out(image.size());
+    detail::forEachRow(execution::par, static_cast<size_t>(image.rows),
+        static_cast<size_t>(image.cols), [&](size_t y)
+    {
+        const int row = static_cast<int>(y);
+        applyLutRowPerChannel(image[row]->val, static_cast<size_t>(image.cols), luts,
+            out[row]->val);
+    });
+    return out;
+}
+
+} // namespace detail
+
+/// Map each channel of a three channel image through its own table.
+/// The tables must have lutSize<T>() entries.
+template<typename T>
+cv::Mat_<cv::Vec<T, 3>> applyLutPerChannel(
+    const cv::Mat_<cv::Vec<T, 3>>& image, const std::array<std::vector<T>, 3>& luts)
+{
+    for (const auto& lut : luts)
+    {
+        CHECK_EQ(lut.size(), lutSize<T>());
+    }
+    const T* const lut_data[3] = {luts[0].data(), luts[1].data(), luts[2].data()};
+    return detail::applyLutPerChannel(image, lut_data);
+}
+
+/// Map all channels of a three channel image through the same table.
+template<typename T>
+cv::Mat_<cv::Vec<T, 3>> applyLutPerChannel(
+    const cv::Mat_<cv::Vec<T, 3>>& image, const std::vector<T>& lut)
+{
+    CHECK_EQ(lut.size(), lutSize<T>());
+    const T* const lut_data[3] = {lut.data(), lut.data(), lut.data()};
+    return detail::applyLutPerChannel(image, lut_data);
+}
+
+} // namespace komb
@@ -5,11 +5,13 @@
 #include <opencv2/opencv.hpp>
 
 #include <common/Logging.hpp>
+#include <common/Profiler.hpp>
 
 namespace komb {
 
 cv::Mat1f edgeMagnitude(const cv::Mat& image)
 {
+    PROFILE_STAGE(edgeMagnitude);
     std::vector<cv::Mat> channels;
     cv::split(image, channels);
     cv::Mat1f magnitude(image.size(), 0);
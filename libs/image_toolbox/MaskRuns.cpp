@@ -0,0 +1,113 @@
+#include "MaskRuns.hpp"
+
+#include <cstdint>
+#include <numeric>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <common/Logging.hpp>
+#include <common/TaskScheduler.hpp>
+
+namespace komb {
+
+namespace {
+
+/// Rows are split into blocks of about this many pixels to find their runs in parallel.
+const size_t kPixelsPerBlock = 1 << 16;
+
+/// Append the runs of one row and return the number of masked pixels in it.
+size_t findRowRuns(const uint8_t* row, int cols, std::vector<MaskRuns::Run>& out_runs)
+{
+    size_t count = 0;
+    bool inside = false;
+    int run_begin = 0;
+    auto step = [&](int x, bool set)
+    {
+        if (set && !inside)
+        {
+            run_begin = x;
+        }
+        else if (!set && inside)
+        {
+            out_runs.push_back({run_begin, x});
+            count += static_cast<size_t>(x - run_begin);
+        }
+        inside = set;
+    };
+
+    int x = 0;
+#ifdef __SSE2__
+    // Skip 16 pixels at a time while they all continue the current run, or the current gap.
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= cols; x += 16)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+        const int set_bits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(pixels, zero)) & 0xFFFF;
+        if (set_bits == (inside ? 0xFFFF : 0))
+        {
+            continue;
+        }
+        for (int i = 0; i < 16; ++i)
+        {
+            step(x + i, (set_bits >> i) & 1);
+        }
+    }
+#endif
+    for (; x < cols; ++x)
+    {
+        step(x, row[x] != 0);
+    }
+    step(cols, false);
+    return count;
+}
+
+} // namespace
+
+MaskRuns::MaskRuns()
+    : size_(0, 0)
+    , row_runs_(1, 0)
+    , row_offsets_(1, 0)
+{}
+
+MaskRuns::MaskRuns(const cv::Mat1b& mask)
+    : size_(mask.size())
+    , row_runs_(static_cast<size_t>(mask.rows) + 1, 0)
+    , row_offsets_(static_cast<size_t>(mask.rows) + 1, 0)
+{
+    const size_t rows = static_cast<size_t>(mask.rows);
+    const size_t rows_per_block =
+        std::max<size_t>(1, kPixelsPerBlock / static_cast<size_t>(std::max(1, mask.cols)));
+    const size_t num_blocks = (rows + rows_per_block - 1) / rows_per_block;
+
+    // Each block finds its runs on its own, and counts them at index y + 1 of each row, so that
+    // a prefix sum turns the counts into where each row starts.
+    std::vector<std::vector<Run>> block_runs(num_blocks);
+    globalTaskScheduler().parallelFor(num_blocks, 1, [&](size_t begin, size_t end)
+    {
+        for (size_t block = begin; block < end; ++block)
+        {
+            const size_t y_end = std::min(rows, (block + 1) * rows_per_block);
+            for (size_t y = block * rows_per_block; y < y_end; ++y)
+            {
+                const size_t num_runs_before = block_runs[block].size();
+                row_offsets_[y + 1] =
+                    findRowRuns(mask[static_cast<int>(y)], mask.cols, block_runs[block]);
+                row_runs_[y + 1] = block_runs[block].size() - num_runs_before;
+            }
+        }
+    });
+
+    std::partial_sum(row_runs_.begin(), row_runs_.end(), row_runs_.begin());
+    std::partial_sum(row_offsets_.begin(), row_offsets_.end(), row_offsets_.begin());
+
+    runs_.reserve(row_runs_.back());
+    for (const auto& runs : block_runs)
+    {
+        runs_.insert(runs_.end(), runs.begin(), runs.end());
+    }
+    CHECK_EQ(runs_.size(), row_runs_.back());
+}
+
+} // namespace komb
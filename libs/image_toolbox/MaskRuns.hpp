@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include <common/algorithm/ExecutionPolicy.hpp>
+
+namespace komb {
+
+/**
+ * @brief Run-length representation of a mask, for gathering and scattering the masked pixels.
+ *
+ * Each row of the mask is stored as the runs of consecutive non-zero pixels. Together with the
+ * number of masked pixels before each row, this lets whole runs be copied at once and rows be
+ * processed in parallel, each writing to its own part of the output.
+ *
+ * Build it once and reuse it when several images share the same mask:
+ *
+ *     const MaskRuns runs(mask);
+ *     imageToVector(depth, runs, depth_values);
+ *     imageToVector(color, runs, color_values);
+ */
+class MaskRuns
+{
+public:
+    /// The masked pixels [x_begin, x_end) of one row.
+    struct Run
+    {
+        int x_begin;
+        int x_end;
+    };
+
+    /// An empty mask.
+    MaskRuns();
+
+    explicit MaskRuns(const cv::Mat1b& mask);
+
+    cv::Size size() const { return size_; }
+    int      rows() const { return size_.height; }
+    int      cols() const { return size_.width; }
+
+    /// The number of masked pixels.
+    size_t count() const { return row_offsets_.back(); }
+
+    size_t numRuns() const { return runs_.size(); }
+
+    /// The runs of row y, from left to right.
+    const Run* rowBegin(int y) const { return runs_.data() + row_runs_[static_cast<size_t>(y)]; }
+    const Run* rowEnd(int y) const { return runs_.data() + row_runs_[static_cast<size_t>(y) + 1]; }
+
+    /// The number of masked pixels above row y, i.e. where row y starts in a gathered vector.
+    size_t rowOffset(int y) const { return row_offsets_[static_cast<size_t>(y)]; }
+
+    /// The smallest number of rows worth handing to another thread.
+    size_t minParallelRows() const
+    {
+        return std::max<size_t>(1, detail::kMinParallelChunk / std::max(1, size_.width));
+    }
+
+private:
+    cv::Size            size_;
+    std::vector<Run>    runs_;
+    std::vector<size_t> row_runs_;    ///< rows + 1 indices into runs_.
+    std::vector<size_t> row_offsets_; ///< rows + 1 prefix sums of masked pixels per row.
+};
+
+namespace detail {
+
+/// Copy the masked pixels of img to out, row by row.
+template<typename T, execution::Kind kKind>
+void gatherRuns(
+    execution::Policy<kKind> policy, const MaskRuns& runs, const cv::Mat_<T>& img, T* out)
+{
+    forEachChunk(policy, static_cast<size_t>(runs.rows()), [&](size_t begin, size_t end)
+    {
+        for (int y = static_cast<int>(begin); y < static_cast<int>(end); ++y)
+        {
+            const T* row = img[y];
+            T* dst = out + runs.rowOffset(y);
+            for (const auto* run = runs.rowBegin(y); run != runs.rowEnd(y); ++run)
+            {
+                dst = std::copy(row + run->x_begin, row + run->x_end, dst);
+            }
+        }
+    }, runs.minParallelRows());
+}
+
+/// Copy values to the masked pixels of io_img, row by row.
+template<typename T, execution::Kind kKind>
+void scatterRuns(
+    execution::Policy<kKind> policy, const MaskRuns& runs, const T* values, cv::Mat_<T>& io_img)
+{
+    forEachChunk(policy, static_cast<size_t>(runs.rows()), [&](size_t begin, size_t end)
+    {
+        for (int y = static_cast<int>(begin); y < static_cast<int>(end); ++y)
+        {
+            T* row = io_img[y];
+            const T* src = values + runs.rowOffset(y);
+            for (const auto* run = runs.rowBegin(y); run != runs.rowEnd(y); ++run)
+            {
+                const int length = run->x_end - run->x_begin;
+                std::copy(src, src + length, row + run->x_begin);
+                src += length;
+            }
+        }
+    }, runs.minParallelRows());
+}
+
+} // namespace detail
+
+} // namespace komb
@@ -0,0 +1,109 @@
+#define BOOST_TEST_DYN_LINK
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <opencv2/core.hpp>
+
+#include <image_toolbox/MaskRuns.hpp>
+#include <image_toolbox/Reshape.hpp>
+
+BOOST_AUTO_TEST_SUITE(komb)
+BOOST_AUTO_TEST_SUITE(image_toolbox)
+
+namespace {
+
+/// Large enough to be split between threads, with long runs, long gaps and single pixels.
+/// The width is not a multiple of 16, to cover the SIMD tail.
+cv::Mat1b randomMask()
+{
+    cv::Mat1b noise(300, 203);
+    cv::randu(noise, 0, 256);
+    cv::Mat1b mask(noise.size(), uint8_t(0));
+    for (int y = 0; y < mask.rows; ++y)
+    {
+        for (int x = 0; x < mask.cols; ++x)
+        {
+            const bool in_band = (x / 40 + y / 50) % 2 == 0;
+            mask(y, x) = in_band ? (noise(y, x) < 250 ? 255 : 0) : (noise(y, x) < 5 ? 7 : 0);
+        }
+    }
+    return mask;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(MaskRunsCoverMask)
+{
+    const cv::Mat1b mask = randomMask();
+    const komb::MaskRuns runs(mask);
+    BOOST_REQUIRE_EQUAL(runs.size(), mask.size());
+    BOOST_CHECK_EQUAL(runs.count(), static_cast<size_t>(cv::countNonZero(mask)));
+
+    cv::Mat1b painted(mask.size(), uint8_t(0));
+    size_t offset = 0;
+    for (int y = 0; y < mask.rows; ++y)
+    {
+        BOOST_REQUIRE_EQUAL(runs.rowOffset(y), offset);
+        int prev_end = -1;
+        for (const auto* run = runs.rowBegin(y); run != runs.rowEnd(y); ++run)
+        {
+            // Runs are sorted, non-empty and separated by at least one unmasked pixel.
+            BOOST_REQUIRE(prev_end < run->x_begin && run->x_begin < run->x_end);
+            painted(cv::Range(y, y + 1), cv::Range(run->x_begin, run->x_end)).setTo(255);
+            offset += static_cast<size_t>(run->x_end - run->x_begin);
+            prev_end = run->x_end;
+        }
+    }
+    BOOST_CHECK_EQUAL(cv::norm(painted, mask != 0, cv::NORM_INF), 0.0);
+
+    BOOST_CHECK_EQUAL(komb::MaskRuns().count(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(MaskedGatherAndScatter)
+{
+    const cv::Mat1b mask = randomMask();
+    cv::Mat1f image(mask.size());
+    cv::randu(image, -1.0f, 1.0f);
+
+    std::vector<float> expected;
+    std::vector<int> expected_indices;
+    for (int y = 0; y < mask.rows; ++y)
+    {
+        for (int x = 0; x < mask.cols; ++x)
+        {
+            if (mask(y, x))
+            {
+                expected.push_back(image(y, x));
+                expected_indices.push_back(y * mask.cols + x);
+            }
+        }
+    }
+
+    std::vector<float> values;
+    komb::imageToVector(image, mask, values);
+    BOOST_CHECK(values == expected);
+
+    const cv::Mat1f values_mat = komb::imageToVector(image, mask);
+    BOOST_CHECK(std::vector<float>(values_mat.begin(), values_mat.end()) == expected);
+
+    std::vector<int> indices;
+    komb::maskToIndices(mask, indices);
+    BOOST_CHECK(indices == expected_indices);
+
+    // Scatter back, also from a column that is not continuous in memory.
+    cv::Mat1f columns(static_cast<int>(values.size()), 2, 0.0f);
+    cv::Mat1f(values).copyTo(columns.col(1));
+    const cv::Mat1f restored = komb::vectorToImage(cv::Mat1f(columns.col(1)), mask);
+    cv::Mat1f masked_image(image.size(), 0.0f);
+    image.copyTo(masked_image, mask);
+    BOOST_CHECK_EQUAL(cv::norm(restored, masked_image, cv::NORM_INF), 0.0);
+
+    const komb::MaskRuns runs(mask);
+    cv::Mat1f restored_from_vector(image.size(), 0.0f);
+    komb::vectorToImage(values, runs, restored_from_vector);
+    BOOST_CHECK_EQUAL(cv::norm(restored_from_vector, masked_image, cv::NORM_INF), 0.0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,56 @@
 
 namespace komb {
 
+namespace {
+
+#if CV_VERSION_MAJOR >= 4
+using AccessFlags = cv::AccessFlag;
+#else
+using AccessFlags = int;
+#endif
+
+/// Releases the buffers made by shareCvMatBuffer by dropping the reference to their owner.
+/// OpenCV only calls it through UMatData::currAllocator, so allocation is left to the default.
+class SharedBufferAllocator : public cv::MatAllocator
+{
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+        AccessFlags flags, cv::UMatUsageFlags usage_flags) const override
+    {
+        return cv::Mat::getDefaultAllocator()->allocate(
+            dims, sizes, type, data, step, flags, usage_flags);
+    }
+
+    bool allocate(
+        cv::UMatData* data, AccessFlags access_flags, cv::UMatUsageFlags usage_flags) const override
+    {
+        return cv::Mat::getDefaultAllocator()->allocate(data, access_flags, usage_flags);
+    }
+
+    void deallocate(cv::UMatData* data) const override
+    {
+        if (data == nullptr) { return; }
+        delete static_cast<std::shared_ptr<const void>*>(data->userdata);
+        delete data;
+    }
+};
+
+} // namespace
+
+cv::Mat shareCvMatBuffer(
+    void* data, int rows, int cols, int type, std::shared_ptr<const void> owner)
+{
+    static const SharedBufferAllocator allocator;
+    cv::Mat mat(rows, cols, type, data);
+    auto* shared_data = new cv::UMatData(&allocator);
+    shared_data->data = shared_data->origdata = static_cast<uchar*>(data);
+    shared_data->size = mat.total() * mat.elemSize();
+    shared_data->refcount = 1;
+    shared_data->userdata = new std::shared_ptr<const void>(std::move(owner));
+    mat.u = shared_data;
+    return mat;
+}
+
 Imageb maskFromCvMat(const cv::Mat& cv_image_in)
 {
     cv::Mat cv_image = cv_image_in;
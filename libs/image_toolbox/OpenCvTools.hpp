@@ -1,7 +1,9 @@
 #pragma once
 
 #include <algorithm>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <opencv2/core/mat.hpp>
@@ -230,6 +232,34 @@ Image<T> makeImage(const cv::Mat_<T>& in)
     return Image<T>(image::width(in), image::height(in), image::data(in));
 }
 
+/// Zero-copy: the image shares the pixels of in and keeps them alive through the OpenCV reference
+/// count, so writes to one are seen in the other. Non-continuous input is copied first.
+template <typename T>
+Image<T> shareImage(const cv::Mat_<T>& in)
+{
+    if (in.empty()) { return {}; }
+    const cv::Mat_<T> continuous = in.isContinuous() ? in : in.clone();
+    T* pixels = const_cast<T*>(image::data(continuous));
+    return Image<T>::share(pixels, image::width(in), image::height(in),
+        std::make_shared<cv::Mat>(continuous));
+}
+
+/// A cv::Mat of data that is kept alive by owner, and released through the OpenCV reference count.
+cv::Mat shareCvMatBuffer(
+    void* data, int rows, int cols, int type, std::shared_ptr<const void> owner);
+
+/// Zero-copy: the matrix takes over the pixels of in, and frees them when the last cv::Mat
+/// referencing them is released. Views do not own their pixels, so they are copied instead.
+template <typename T>
+cv::Mat_<T> shareCvMat(Image<T>&& in)
+{
+    if (in.empty()) { return {}; }
+    if (!in.ownsData()) { return makeCvMat(in); }
+    auto owner = std::make_shared<Image<T>>(std::move(in));
+    return shareCvMatBuffer(owner->data(), image::heightInt(*owner), image::widthInt(*owner),
+        cv::DataType<T>::type, std::move(owner));
+}
+
 inline Imagef makeImageFloat(const cv::Mat& in)
 {
     CHECK_EQ(in.type(), CV_32FC1);
@@ -243,11 +273,22 @@ auto mapImageFromCv(const cv::Mat_<InType>& in, UnaryOperation op)
     using value_type_out = decltype(op(*in.begin()));
     const auto width  = image::width(in);
     const auto height = image::height(in);
-    auto out = Image<value_type_out>(width, height);
+    auto out = Image<value_type_out>(width, height, kUninitialized);
     transform(in, out, op);
     return out;
 }
 
+/// Like mapImageFromCv, with an execution policy for transform, see ExecutionPolicy.hpp.
+template <execution::Kind kKind, typename InType, typename UnaryOperation>
+auto mapImageFromCv(execution::Policy<kKind> policy, const cv::Mat_<InType>& in, UnaryOperation op)
+{
+    using value_type_out = decltype(op(*in.begin()));
+    auto out = Image<value_type_out>(image::width(in), image::height(in), kUninitialized);
+    // Raw pointers instead of cv::MatIterator_, for random access without the row lookups.
+    transform(policy, makeConstArrayPointer(in), out, op);
+    return out;
+}
+
 Imageb maskFromCvMat(const cv::Mat& cv_image);
 Imageb imageMaskFromCv(const cv::Mat1b& cv_mask);
 cv::Mat1b cvMaskFromImage(const Imageb& image_mask);
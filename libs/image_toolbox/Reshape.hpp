@@ -6,8 +6,11 @@
 #include <opencv2/core.hpp>
 #include <vector>
 
+#include <common/algorithm/ExecutionPolicy.hpp>
 #include <common/Logging.hpp>
 
+#include "MaskRuns.hpp"
+
 namespace komb {
 
 /**
@@ -67,6 +70,18 @@ cv::Mat reshapeAndTile(
         int border = 0,
         const cv::Scalar& color = cv::Scalar(0));
 
+/// Copy the masked pixels of img to vec, row by row, in parallel for large images.
+template <typename T>
+void imageToVector(
+        const cv::Mat_<T>& img,
+        const MaskRuns& runs,
+        std::vector<T>& vec)
+{
+    CHECK_EQ(img.size(), runs.size());
+    vec.resize(runs.count());
+    detail::gatherRuns(execution::par, runs, img, vec.data());
+}
+
 template <typename T>
 void imageToVector(
         const cv::Mat_<T>& img,
@@ -74,18 +89,20 @@ void imageToVector(
         std::vector<T>& vec)
 {
     CHECK_EQ(img.size(), mask.size());
-    vec.clear();
+    imageToVector(img, MaskRuns(mask), vec);
+}
 
-    // Loop through mask and insert selected pixels from img into vec
-    for (int y = 0; y < img.rows; ++y)
+template <typename T>
+void imageToVector(
+    const cv::Mat_<T>& img,
+    const MaskRuns&    runs,
+    cv::Mat_<T>&       out_vec)
+{
+    CHECK_EQ(img.size(), runs.size());
+    out_vec.create(1, static_cast<int>(runs.count()));
+    if (runs.count() > 0)
     {
-        for (int x = 0; x < img.cols; ++x)
-        {
-            if (mask(y, x))
-            {
-                vec.push_back(img(y, x));
-            }
-        }
+        detail::gatherRuns(execution::par, runs, img, out_vec[0]);
     }
 }
 
@@ -96,21 +113,7 @@ void imageToVector(
     cv::Mat_<T>&       out_vec)
 {
     CHECK_EQ(img.size(), mask.size());
-    out_vec.create(1, cv::countNonZero(mask));
-
-    // Loop through mask and insert selected pixels from img into out_vec
-    size_t index = 0;
-    for (int y = 0; y < img.rows; ++y)
-    {
-        for (int x = 0; x < img.cols; ++x)
-        {
-            if (mask(y, x))
-            {
-                out_vec(index) = img(y, x);
-                ++index;
-            }
-        }
-    }
+    imageToVector(img, MaskRuns(mask), out_vec);
 }
 
 template <typename T>
@@ -121,6 +124,18 @@ cv::Mat_<T> imageToVector(const cv::Mat_<T>& img, const cv::Mat1b& mask)
     return vec;
 }
 
+/// Copy vec to the masked pixels of img, row by row, in parallel for large images.
+template <typename T>
+void vectorToImage(
+        const std::vector<T> &vec,
+        const MaskRuns& runs,
+        cv::Mat_<T>& img)
+{
+    CHECK_EQ(img.size(), runs.size());
+    CHECK_EQ(runs.count(), vec.size());
+    detail::scatterRuns(execution::par, runs, vec.data(), img);
+}
+
 template <typename T>
 void vectorToImage(
         const std::vector<T> &vec,
@@ -128,44 +143,31 @@ void vectorToImage(
         cv::Mat_<T>& img)
 {
     CHECK_EQ(img.size(), mask.size());
+    vectorToImage(vec, MaskRuns(mask), img);
+}
 
-    // Loop through mask and insert selected pixels from vec into img
-    size_t counter = 0;
-    for (int y = 0; y < img.rows; ++y)
+template <typename T>
+void vectorToImage(const cv::Mat_<T>& vec, const MaskRuns& runs, cv::Mat_<T>& img)
+{
+    CHECK_EQ(img.size(), runs.size());
+    CHECK(vec.rows == 1 || vec.cols == 1) << "vec has size " << vec.size()
+            << " but should be a row or column vector.";
+    CHECK_EQ(runs.count(), vec.total());
+    if (runs.count() == 0)
     {
-        for (int x = 0; x < img.cols; ++x)
-        {
-            if (mask(y, x))
-            {
-                img(y, x) = vec[counter];
-                ++counter;
-            }
-        }
+        return;
     }
-    CHECK_EQ(counter, vec.size());
+
+    // A column of a larger matrix is not continuous.
+    const cv::Mat_<T> continuous_vec = vec.isContinuous() ? vec : vec.clone();
+    detail::scatterRuns(execution::par, runs, continuous_vec[0], img);
 }
 
 template <typename T>
 void vectorToImage(const cv::Mat_<T>& vec, const cv::Mat1b& mask, cv::Mat_<T>& img)
 {
     CHECK_EQ(img.size(), mask.size());
-    CHECK(vec.rows == 1 || vec.cols == 1) << "vec has size " << vec.size()
-            << " but should be a row or column vector.";
-
-    // Loop through mask and insert selected pixels from vec into img.
-    int counter = 0;
-    for (int y = 0; y < img.rows; ++y)
-    {
-        for (int x = 0; x < img.cols; ++x)
-        {
-            if (mask(y, x))
-            {
-                img(y, x) = vec(counter);
-                ++counter;
-            }
-        }
-    }
-    CHECK_EQ(counter, vec.size().area());
+    vectorToImage(vec, MaskRuns(mask), img);
 }
 
 template <typename T>
@@ -177,23 +179,31 @@ cv::Mat_<T> vectorToImage(const cv::Mat_<T>& vec, const cv::Mat1b& mask)
 }
 
 template <typename T>
-void maskToIndices(const cv::Mat1b& mask, std::vector<T>& indices)
+void maskToIndices(const MaskRuns& runs, std::vector<T>& indices)
 {
-    indices.clear();
-
-    // Loop through mask and store indices of non-zero elements
-    size_t i = 0;
-    for (int y = 0; y < mask.rows; ++y)
+    indices.resize(runs.count());
+    detail::forEachChunk(execution::par, static_cast<size_t>(runs.rows()),
+        [&](size_t begin, size_t end)
     {
-        for (int x = 0; x < mask.cols; ++x)
+        for (int y = static_cast<int>(begin); y < static_cast<int>(end); ++y)
         {
-            if (mask(y, x))
+            const size_t row_start = static_cast<size_t>(y) * static_cast<size_t>(runs.cols());
+            T* out = indices.data() + runs.rowOffset(y);
+            for (const auto* run = runs.rowBegin(y); run != runs.rowEnd(y); ++run)
             {
-                indices.push_back(i);
+                for (int x = run->x_begin; x < run->x_end; ++x)
+                {
+                    *out++ = static_cast<T>(row_start + static_cast<size_t>(x));
+                }
             }
-            ++i;
         }
-    }
+    }, runs.minParallelRows());
+}
+
+template <typename T>
+void maskToIndices(const cv::Mat1b& mask, std::vector<T>& indices)
+{
+    maskToIndices(MaskRuns(mask), indices);
 }
 
 template <typename T>
@@ -1,20 +1,27 @@
 #include "Visualization.hpp"
 
 #include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <numeric>
 #include <string>
 #include <vector>
 
 #include <opencv2/opencv.hpp>
 
+#include <common/algorithm/ExecutionPolicy.hpp>
 #include <common/algorithm/Range.hpp>
 #include <common/algorithm/Vector.hpp>
 #include <common/Math.hpp>
+#include <common/TaskScheduler.hpp>
 #include <geometry_toolbox/Angle.hpp>
 #include <geometry_toolbox/Types.hpp>
 
 #include "Color.hpp"
 #include "Convert.hpp"
 #include "Gamma.hpp"
+#include "Lut.hpp"
 #include "OpenCvTools.hpp"
 
 namespace komb {
@@ -23,6 +30,9 @@ namespace komb {
 static const int kShift = 8;
 static const float kShiftMultiplier = 1 << kShift;
 
+// applyColormap interpolates images with at most this many pixels directly, without a table.
+static const size_t kMinColormapLutSize = 4096;
+
 Vector3f applyColormapScalar(float value, const VectorOfVector3f& colors)
 {
     CHECK(!colors.empty());
@@ -37,15 +47,57 @@ cv::Mat3b applyColormap(const cv::Mat1f& image, const std::vector<cv::Scalar>& c
     float min_value, float max_value)
 {
     CHECK(!colors.empty());
+
     const float max_i = static_cast<float>(colors.size()) - 1;
-    return map(image, [&](float value)
+    const auto color_at = [&](float t) // t in [0, max_i]
     {
-        const float t = remapClamp(value, min_value, max_value, 0.f, max_i);
         const size_t a = floorToSize(t);
         const size_t b = ceilToSize(t);
         const cv::Scalar color = colors[a] + (colors[b] - colors[a]) * (t - a);
         return cv::Vec3b(color[0], color[1], color[2]);
+    };
+
+    // Small images are cheaper to interpolate per pixel than to build a table for.
+    const size_t num_pixels = image.total();
+    if (num_pixels <= kMinColormapLutSize)
+    {
+        return map(image, [&](float value)
+        {
+            return color_at(remapClamp(value, min_value, max_value, 0.f, max_i));
+        });
+    }
+
+    // Otherwise quantize the values and look up the colors in a table, with at most one entry
+    // per pixel, so that building the table never costs more than interpolating the image.
+    const size_t lut_size = std::min(lutSize<uint16_t>(), num_pixels);
+    const float scale = static_cast<float>(lut_size - 1);
+    std::vector<cv::Vec3b> lut(lut_size);
+    for (size_t i = 0; i < lut_size; ++i)
+    {
+        lut[i] = color_at(static_cast<float>(i) * max_i / scale);
+    }
+
+    cv::Mat3b out(image.size());
+    detail::forEachRow(execution::par, static_cast<size_t>(image.rows),
+        static_cast<size_t>(image.cols), [&](size_t y)
+    {
+        const float* row = image[static_cast<int>(y)];
+        cv::Vec3b* out_row = out[static_cast<int>(y)];
+        const size_t cols = static_cast<size_t>(image.cols);
+        uint16_t indices[256];
+        for (size_t begin = 0; begin < cols; begin += 256)
+        {
+            const size_t n = std::min<size_t>(256, cols - begin);
+            for (size_t i = 0; i < n; ++i)
+            {
+                const float t = remapClamp(row[begin + i], min_value, max_value, 0.f, scale);
+                // Written so that NaN maps to the first color.
+                indices[i] = t > 0 ? static_cast<uint16_t>(t + 0.5f) : 0;
+            }
+            detail::applyLutRow(indices, n, lut.data(), out_row + begin);
+        }
     });
+    return out;
 }
 
 void quiver(cv::Mat& io_canvas, const cv::Mat2f& flow, int spacing)
@@ -140,22 +192,217 @@ cv::Mat3f colorizeDepthImage(const cv::Mat1f& depth_image, Normalize normalize)
     return cv::Mat3f(colormapped) * (1.0f / 255.0f);
 }
 
-cv::Mat3f colorizeAndShadeDepthImage(const cv::Mat1f& depth_image, Normalize normalize)
+namespace {
+
+/// Index of the pixel at i in [-1, n] with cv::BORDER_REFLECT_101, like cv::Sobel uses.
+int reflect101(int i, int n)
 {
-    // Colored depth.
-    cv::Mat3f colormapped = komb::colorizeDepthImage(depth_image, normalize);
+    if (n == 1) { return 0; }
+    return i < 0 ? -i : i >= n ? 2 * n - 2 - i : i;
+}
 
-    // Shaded depth.
-    cv::Mat1f shaded = komb::shadeDepthImage(depth_image);
+/// srgbFromLinear sampled on [0, 1], to be interpolated linearly.
+class SrgbLut
+{
+public:
+    static const int kSize = 1024;
+
+    SrgbLut()
+    {
+        for (int i = 0; i <= kSize; ++i)
+        {
+            values_[i] = srgbFromLinear(static_cast<float>(i) / kSize);
+        }
+    }
+
+    /// linear must be in [0, 1].
+    float operator()(float linear) const
+    {
+        const float t = linear * kSize;
+        const int i = std::min(static_cast<int>(t), kSize - 1);
+        return values_[i] + (values_[i + 1] - values_[i]) * (t - static_cast<float>(i));
+    }
+
+private:
+    float values_[kSize + 1];
+};
 
-    // Shaded colored depth.
-    cv::Mat shaded_colormapped;
-    cv::Mat multi_channel_shaded;
-    cv::merge(std::vector<cv::Mat>({shaded, shaded, shaded}), multi_channel_shaded);
-    cv::multiply(0.2f + multi_channel_shaded * 0.8f, colormapped, shaded_colormapped);
+/// The colors of cv::COLORMAP_RAINBOW for 255 - depth_char, scaled to [0, 1], with the
+/// histogram equalization of colorizeDepthImage applied up front.
+std::vector<cv::Vec3f> depthColorLut(const cv::Mat1f& depth_image, Normalize normalize,
+    double& out_min_inverse_depth, double& out_max_inverse_depth)
+{
+    const size_t rows = static_cast<size_t>(depth_image.rows);
+    const size_t cols = static_cast<size_t>(depth_image.cols);
+    const size_t min_rows =
+        std::max<size_t>(1, detail::kMinParallelChunk / std::max<size_t>(1, cols));
+
+    std::vector<uint8_t> equalized(256);
+    std::iota(equalized.begin(), equalized.end(), 0);
+    out_min_inverse_depth = 1.0 / 0.2;
+    out_max_inverse_depth = 1.0 / 0.8;
+
+    if (normalize == Normalize::kYes)
+    {
+        std::mutex mutex;
+        float min_inverse_depth = std::numeric_limits<float>::infinity();
+        float max_inverse_depth = -std::numeric_limits<float>::infinity();
+        globalTaskScheduler().parallelFor(rows, min_rows, [&](size_t begin, size_t end)
+        {
+            float chunk_min = std::numeric_limits<float>::infinity();
+            float chunk_max = -std::numeric_limits<float>::infinity();
+            for (size_t y = begin; y < end; ++y)
+            {
+                const float* depth_row = depth_image[static_cast<int>(y)];
+                for (size_t x = 0; x < cols; ++x)
+                {
+                    if (depth_row[x] != 0)
+                    {
+                        chunk_min = std::min(chunk_min, 1.f / depth_row[x]);
+                        chunk_max = std::max(chunk_max, 1.f / depth_row[x]);
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            min_inverse_depth = std::min(min_inverse_depth, chunk_min);
+            max_inverse_depth = std::max(max_inverse_depth, chunk_max);
+        });
+        if (min_inverse_depth > max_inverse_depth)
+        {
+            // No depth at all, everything will be black.
+            return std::vector<cv::Vec3f>(256, cv::Vec3f(0, 0, 0));
+        }
+        out_min_inverse_depth = min_inverse_depth;
+        out_max_inverse_depth = max_inverse_depth;
+
+        // The histogram of the scaled inverse depth, for the same lookup table as
+        // cv::equalizeHist. Missing depth is put in bin 0 explicitly. colorizeDepthImage ends up
+        // there too on x86, but only because it converts an infinite inverse depth to an integer.
+        const float scale =
+            static_cast<float>(255.0 / (out_max_inverse_depth - out_min_inverse_depth));
+        const float offset = static_cast<float>(out_min_inverse_depth);
+        std::vector<int> histogram(256, 0);
+        globalTaskScheduler().parallelFor(rows, min_rows, [&](size_t begin, size_t end)
+        {
+            int chunk_histogram[256] = {};
+            for (size_t y = begin; y < end; ++y)
+            {
+                const float* depth_row = depth_image[static_cast<int>(y)];
+                for (size_t x = 0; x < cols; ++x)
+                {
+                    const uint8_t bin = depth_row[x] == 0 ? 0 :
+                        cv::saturate_cast<uint8_t>((1.f / depth_row[x] - offset) * scale);
+                    chunk_histogram[bin] += 1;
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int i = 0; i < 256; ++i)
+            {
+                histogram[i] += chunk_histogram[i];
+            }
+        });
+
+        int first = 0;
+        while (histogram[first] == 0) { ++first; }
+        const int total = static_cast<int>(rows * cols);
+        if (histogram[first] == total)
+        {
+            std::fill(equalized.begin(), equalized.end(), static_cast<uint8_t>(first));
+        }
+        else
+        {
+            const float equalize_scale = 255.f / static_cast<float>(total - histogram[first]);
+            int sum = 0;
+            equalized[first] = 0;
+            for (int i = first + 1; i < 256; ++i)
+            {
+                sum += histogram[i];
+                equalized[i] = cv::saturate_cast<uint8_t>(static_cast<float>(sum) * equalize_scale);
+            }
+        }
+    }
+
+    cv::Mat1b ramp(1, 256);
+    std::iota(ramp.begin(), ramp.end(), 0);
+    cv::Mat3b rainbow;
+    cv::applyColorMap(255 - ramp, rainbow, cv::COLORMAP_RAINBOW);
+
+    std::vector<cv::Vec3f> colors(256);
+    for (int i = 0; i < 256; ++i)
+    {
+        colors[i] = cv::Vec3f(rainbow(0, equalized[i])) * (1.0f / 255.0f);
+    }
+    return colors;
+}
+
+} // namespace
+
+cv::Mat3f colorizeAndShadeDepthImage(const cv::Mat1f& depth_image, Normalize normalize)
+{
+    cv::Mat3f shaded_colormapped;
+    colorizeAndShadeDepthImage(depth_image, normalize, shaded_colormapped);
     return shaded_colormapped;
 }
 
+void colorizeAndShadeDepthImage(
+    const cv::Mat1f& depth_image, Normalize normalize, cv::Mat3f& out_image)
+{
+    static const SrgbLut srgb_lut;
+
+    double min_inverse_depth = 0;
+    double max_inverse_depth = 0;
+    const std::vector<cv::Vec3f> colors =
+        depthColorLut(depth_image, normalize, min_inverse_depth, max_inverse_depth);
+    const float scale = static_cast<float>(255.0 / (max_inverse_depth - min_inverse_depth));
+    const float offset = static_cast<float>(min_inverse_depth);
+
+    const cv::Vec3f light_direction = cv::normalize(cv::Vec3f(0, 0, -1));
+    const int rows = depth_image.rows;
+    const int cols = depth_image.cols;
+    out_image.create(depth_image.size());
+
+    // The same as colorizeDepthImage and shadeDepthImage, in one pass without temporaries.
+    // Each tile reads the 3x3 Sobel neighbourhood straight from the depth image.
+    globalTaskScheduler().parallelFor2d(static_cast<size_t>(cols), static_cast<size_t>(rows),
+        256, 16, [&](const TaskScheduler::Tile& tile)
+    {
+        for (int y = static_cast<int>(tile.y_begin); y < static_cast<int>(tile.y_end); ++y)
+        {
+            const float* above = depth_image[reflect101(y - 1, rows)];
+            const float* row   = depth_image[y];
+            const float* below = depth_image[reflect101(y + 1, rows)];
+            cv::Vec3f* out_row = out_image[y];
+            for (int x = static_cast<int>(tile.x_begin); x < static_cast<int>(tile.x_end); ++x)
+            {
+                const float depth = row[x];
+                if (depth == 0)
+                {
+                    out_row[x] = cv::Vec3f(0, 0, 0);
+                    continue;
+                }
+
+                const int left = reflect101(x - 1, cols);
+                const int right = reflect101(x + 1, cols);
+                const float dx = (above[right] - above[left]) + 2 * (row[right] - row[left]) +
+                    (below[right] - below[left]);
+                const float dy = (below[left] - above[left]) + 2 * (below[x] - above[x]) +
+                    (below[right] - above[right]);
+                const float dz = depth / static_cast<float>(cols);
+                const float inv_norm = 1 / std::sqrt(dx * dx + dy * dy + dz * dz);
+
+                float shaded = (dx * light_direction[0] + dy * light_direction[1] +
+                    -dz * light_direction[2]) * inv_norm;
+                shaded = std::max(shaded, 0.0f) * 0.9f + 0.1f;
+                shaded = srgb_lut(std::min(shaded, 1.0f));
+
+                const uint8_t depth_char =
+                    cv::saturate_cast<uint8_t>((1.f / depth - offset) * scale);
+                out_row[x] = colors[depth_char] * (0.2f + 0.8f * shaded);
+            }
+        }
+    });
+}
+
 cv::Mat3f colorizeNormalMap(const cv::Mat3f& normals)
 {
     std::vector<cv::Mat1f> n;
@@ -483,22 +730,13 @@ cv::Mat3b applyGamma(const cv::Mat3b& image_in, float gamma)
 {
     if (gamma == 1.0f) { return image_in; }
 
-    auto image_out = image_in.clone();
-
-    const std::vector<uint8_t> gamma_lookup = mapVector(irange(255), [gamma](int i) -> uint8_t
+    const std::vector<uint8_t> gamma_lookup =
+        mapVector(irange(static_cast<int>(lutSize<uint8_t>())), [gamma](int i) -> uint8_t
     {
         return roundToByte(std::pow(i / 255.0f, 1.0f / gamma) * 255.0f);
     });
 
-    for (cv::Vec3b& pixel : image_out)
-    {
-        for (const int i : irange(3))
-        {
-            pixel[i] = gamma_lookup[pixel[i]];
-        }
-    }
-
-    return image_out;
+    return applyLutPerChannel(image_in, gamma_lookup);
 }
 
 }  // namespace komb
@@ -21,8 +21,14 @@ cv::Mat3b applyColormap(const cv::Mat1f& image, const std::vector<cv::Scalar>& c
 void quiver(cv::Mat& io_canvas, const cv::Mat2f& flow, int spacing);
 cv::Mat1f shadeDepthImage(const cv::Mat1f& depth_image);
 cv::Mat3f colorizeDepthImage(const cv::Mat1f& depth_image, Normalize normalize = Normalize::kYes);
+
+/// The colors of colorizeDepthImage, shaded by shadeDepthImage, computed in one pass.
 cv::Mat3f colorizeAndShadeDepthImage(
     const cv::Mat1f& depth_image, Normalize normalize = Normalize::kYes);
+
+/// Same as above, reusing the memory of out_image, e.g. between the frames of a live view.
+void colorizeAndShadeDepthImage(
+    const cv::Mat1f& depth_image, Normalize normalize, cv::Mat3f& out_image);
 cv::Mat3f colorizeNormalMap(const cv::Mat3f& normals);
 cv::Mat3b colorizeAbsoluteErrors(const cv::Mat1f& errors, float max_error);
 cv::Mat3b colorizeSignedErrors(const cv::Mat1f& errors, float max_error);
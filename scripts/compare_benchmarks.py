@@ -0,0 +1,33 @@
+#!/usr/bin/env python3
+"""Compare two JSON files written by bench_color_calibration --json_out.
+
+Usage: scripts/compare_benchmarks.py before.json after.json
+"""
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        results = json.load(f)["results"]
+    return {(r["name"], r["megapixels"], r["num_threads"]): r for r in results}
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    before = load(sys.argv[1])
+    after = load(sys.argv[2])
+
+    print("{:<28} {:>6} {:>7} {:>12} {:>12} {:>8}".format(
+        "name", "MP", "threads", "before ms", "after ms", "speedup"))
+    for key in sorted(before.keys() & after.keys()):
+        before_ms = before[key]["median_ms"]
+        after_ms = after[key]["median_ms"]
+        speedup = before_ms / after_ms if after_ms > 0 else float("inf")
+        print("{:<28} {:>6.1f} {:>7} {:>12.3f} {:>12.3f} {:>7.2f}x".format(
+            key[0], key[1], key[2], before_ms, after_ms, speedup))
+
+
+if __name__ == "__main__":
+    main()